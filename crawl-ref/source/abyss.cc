@@ -71,6 +71,10 @@ static ProceduralLayout *abyssLayout = nullptr, *levelLayout = nullptr;
 typedef priority_queue<ProceduralSample, vector<ProceduralSample>, ProceduralSamplePQCompare> sample_queue;
 
 static sample_queue abyss_sample_queue;
+// abyssLayout's samples for a whole area, worked out together ahead of
+// _abyss_grid's calls for them. Indexed by abyss_batch_index, -1 if none.
+static vector<ProceduralSample> abyss_batch;
+static FixedArray<int, GXM, GYM> abyss_batch_index(-1);
 static vector<dungeon_feature_type> abyssal_features;
 static list<monster*> displaced_monsters;
 
@@ -1167,6 +1171,13 @@ static ProceduralSample _abyss_grid(const coord_def &p)
         return sample;
     }
 
+    const int batched = abyss_batch_index(p);
+    if (batched >= 0)
+    {
+        abyss_sample_queue.push(abyss_batch[batched]);
+        return abyss_batch[batched];
+    }
+
     if (abyssLayout == nullptr)
     {
         const level_id lid = _get_random_level();
@@ -1239,39 +1250,48 @@ static dungeon_feature_type _veto_dangerous_terrain(dungeon_feature_type feat)
     return feat;
 }
 
-static void _update_abyss_terrain(const coord_def &p,
+// Whether _update_abyss_terrain() would sample the terrain at rp.
+static bool _abyss_terrain_updatable(const coord_def &rp,
     const map_bitmask &abyss_genlevel_mask, bool morph)
 {
-    const coord_def rp = p - abyssal_state.major_coord;
     // ignore dead coordinates
     if (!in_bounds(rp))
-        return;
+        return false;
 
     const dungeon_feature_type currfeat = env.grid(rp);
 
     // Don't decay vaults.
     if (map_masked(rp, MMT_VAULT))
-        return;
+        return false;
 
     switch (currfeat)
     {
         case DNGN_RUNELIGHT:
         case DNGN_EXIT_ABYSS:
         case DNGN_ABYSSAL_STAIR:
-            return;
+            return false;
         default:
             break;
     }
 
     if (feat_is_altar(currfeat))
-        return;
+        return false;
 
     if (!abyss_genlevel_mask(rp))
-        return;
+        return false;
 
-    if (currfeat != DNGN_UNSEEN && !morph)
+    return currfeat == DNGN_UNSEEN || morph;
+}
+
+static void _update_abyss_terrain(const coord_def &p,
+    const map_bitmask &abyss_genlevel_mask, bool morph)
+{
+    const coord_def rp = p - abyssal_state.major_coord;
+    if (!_abyss_terrain_updatable(rp, abyss_genlevel_mask, morph))
         return;
 
+    const dungeon_feature_type currfeat = env.grid(rp);
+
     // What should have been there previously?  It might not be because
     // of external changes such as digging.
     const ProceduralSample sample = _abyss_grid(rp);
@@ -1339,6 +1359,42 @@ static void _ensure_player_habitable(bool dig_instead)
     }
 }
 
+// Sample all the cells that _abyss_apply_terrain() is going to update
+// in one go, which lets the layouts share work between neighbours. Only
+// once the layout exists: building it picks a random level, which has
+// to happen at the same point in the RNG sequence as always. The results
+// are the same as _abyss_grid()'s, and only go on the sample queue if
+// _abyss_grid() asks for them, so nothing else changes either.
+static void _abyss_batch_samples(const map_bitmask &abyss_genlevel_mask,
+                                 bool morph)
+{
+    if (abyssLayout == nullptr)
+        return;
+
+    vector<coord_def> ps;
+    vector<coord_def> cells;
+    for (rectangle_iterator ri(MAPGEN_BORDER); ri; ++ri)
+    {
+        const coord_def pt = *ri + abyssal_state.major_coord;
+        if (_abyss_terrain_updatable(*ri, abyss_genlevel_mask, morph)
+            && !_in_wastes(pt))
+        {
+            ps.push_back(pt);
+            cells.push_back(*ri);
+        }
+    }
+
+    abyssLayout->sample_all(ps, abyssal_state.depth, abyss_batch);
+    for (size_t i = 0; i < cells.size(); ++i)
+        abyss_batch_index(cells[i]) = i;
+}
+
+static void _abyss_clear_batch()
+{
+    abyss_batch.clear();
+    abyss_batch_index.init(-1);
+}
+
 static void _abyss_apply_terrain(const map_bitmask &abyss_genlevel_mask,
                                  bool morph = false, bool now = false)
 {
@@ -1363,6 +1419,9 @@ static void _abyss_apply_terrain(const map_bitmask &abyss_genlevel_mask,
         }
     }
 
+    if (!used_queue)
+        _abyss_batch_samples(abyss_genlevel_mask, morph);
+
     int ii = 0;
     int delta = you.time_taken * (you.abyss_speed + 40) / 200;
     for (rectangle_iterator ri(MAPGEN_BORDER); ri; ++ri)
@@ -1402,6 +1461,7 @@ static void _abyss_apply_terrain(const map_bitmask &abyss_genlevel_mask,
                                    DNGN_ABYSSAL_STAIR,
                                    abyss_genlevel_mask);
     }
+    _abyss_clear_batch();
     if (ii)
         dprf(DIAG_ABYSS, "Nuked %d features", ii);
     _ensure_player_habitable(false);
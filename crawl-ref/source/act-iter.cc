@@ -64,7 +64,7 @@ bool actor_near_iterator::valid(const actor* a) const
 void actor_near_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = env.mons_used.next(i + 1)) >= MAX_MONSTERS)
              return;
     while (!valid(**this));
 }
@@ -72,18 +72,16 @@ void actor_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_near_iterator::monster_near_iterator(coord_def c, los_type los)
-    : center(c), _los(los), viewer(nullptr), i(0)
+    : center(c), _los(los), viewer(nullptr), i(-1)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    advance();
     begin_point = i;
 }
 
 monster_near_iterator::monster_near_iterator(const actor *a, los_type los)
-    : center(a->pos()), _los(los), viewer(a), i(0)
+    : center(a->pos()), _los(los), viewer(a), i(-1)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    advance();
     begin_point = i;
 }
 
@@ -154,7 +152,7 @@ bool monster_near_iterator::valid(const monster* a) const
 void monster_near_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = env.mons_used.next(i + 1)) >= MAX_MONSTERS)
              return;
     while (!valid(**this));
 }
@@ -162,10 +160,10 @@ void monster_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_iterator::monster_iterator()
-    : i(0)
+    : i(env.mons_used.next(0))
 {
     while (i < MAX_MONSTERS && !env.mons[i].alive())
-        i++;
+        i = env.mons_used.next(i + 1);
 }
 
 monster_iterator::operator bool() const
@@ -188,7 +186,7 @@ monster* monster_iterator::operator->() const
 
 monster_iterator& monster_iterator::operator++()
 {
-    while (++i < MAX_MONSTERS)
+    while ((i = env.mons_used.next(i + 1)) < MAX_MONSTERS)
         if (env.mons[i].alive())
             break;
     return *this;
@@ -204,7 +202,7 @@ monster_iterator monster_iterator::operator++(int)
 void monster_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = env.mons_used.next(i + 1)) >= MAX_MONSTERS)
              return;
     while (!(*this)->alive());
 }
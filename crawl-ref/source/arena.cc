@@ -7,7 +7,13 @@
 
 #include "arena.h"
 
+#include <chrono>
 #include <stdexcept>
+#ifdef UNIX
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "act-iter.h"
 #include "colour.h"
@@ -30,6 +36,7 @@
 #include "mon-tentacle.h"
 #include "newgame-def.h"
 #include "ng-init.h"
+#include "options.h"
 #include "prompt.h"
 #include "spl-miscast.h"
 #include "state.h"
@@ -210,6 +217,25 @@ namespace arena
 
     static bool banned_glyphs[128];
 
+    // Batch mode: no display, no delays, rounds split over forked jobs and
+    // a row of statistics appended to arena.tsv at the end.
+    static bool batch = false;
+    static int  batch_jobs = 1;
+
+    // Nobody is around to cancel a batch round in which neither side can
+    // finish the other off, so such rounds are called a tie after this many
+    // turns (0 for no limit).
+    static const int BATCH_MAX_TURNS = 10000;
+    static int turn_limit = 0;
+
+    struct round_result
+    {
+        char winner;    // 'A', 'B' or 'T' for a tie
+        int turns;
+        double seconds; // spent in the fight itself, not setting it up
+    };
+    static vector<round_result> round_results;
+
     static string arena_type = "";
     static faction faction_a(true);
     static faction faction_b(false);
@@ -423,8 +449,21 @@ namespace arena
         name_monsters  = strip_tag(spec, "names");
         random_uniques = strip_tag(spec, "random_uniques");
 
+        batch = strip_tag(spec, "batch");
+        const int njobs = strip_number_tag(spec, "jobs:");
+        if (njobs != TAG_UNFOUND && njobs >= 1 && njobs <= 256)
+            batch_jobs = njobs;
+
+        const int nturns = strip_number_tag(spec, "max_turns:");
+        if (nturns != TAG_UNFOUND && nturns >= 0)
+            turn_limit = nturns;
+        else if (batch)
+            turn_limit = BATCH_MAX_TURNS;
+
+        // Batch runs are for statistics, so allow many more rounds.
         const int ntrials = strip_number_tag(spec, "t:");
-        if (ntrials != TAG_UNFOUND && ntrials >= 1 && ntrials <= 99
+        if (ntrials != TAG_UNFOUND && ntrials >= 1
+            && ntrials <= (batch ? 99999 : 99)
             && !total_trials)
         {
             total_trials = ntrials;
@@ -583,7 +622,8 @@ namespace arena
         tiles.resize();
 #endif
 
-        show_fight_banner();
+        if (!batch)
+            show_fight_banner();
     }
 
     static void expand_mlist(int exp)
@@ -825,19 +865,27 @@ namespace arena
 
     static void do_fight()
     {
-        viewwindow();
-        update_screen();
+        if (!batch)
+        {
+            viewwindow();
+            update_screen();
+        }
         clear_messages(true);
 
+        const auto fight_start = chrono::steady_clock::now();
         {
             cursor_control coff(false);
-            while (fight_is_on() && !contest_cancelled)
+            // Nobody is watching a batch, so only keep the messages if
+            // they're going to the log.
+            msg::suppress quiet(batch && !Options.arena_dump_msgs);
+            while (fight_is_on() && !contest_cancelled
+                   && (!turn_limit || turns < turn_limit))
             {
 #ifdef ARENA_VERBOSE
                 mprf("---- Turn #%d ----", turns);
 #endif
 
-                if (crawl_state.terminal_resized)
+                if (crawl_state.terminal_resized && !batch)
                     show_fight_banner();
 
                 // Check the consistency of our book-keeping every 100 turns.
@@ -851,17 +899,19 @@ namespace arena
                 do_respawn(faction_a);
                 do_respawn(faction_b);
                 balance_spawners();
-                if (!contest_cancelled)
+                if (!contest_cancelled && !batch)
                     ui::delay(Options.view_delay);
                 clear_messages();
                 ASSERT(you.pet_target == MHITNOT);
             }
-            if (!contest_cancelled)
+            if (!contest_cancelled && !batch)
             {
                 viewwindow();
                 update_screen();
             }
         }
+        const chrono::duration<double> fight_time =
+            chrono::steady_clock::now() - fight_start;
 
         if (contest_cancelled)
         {
@@ -874,11 +924,22 @@ namespace arena
 
         trials_done++;
 
+        // Both sides still standing means we ran out of turns.
+        const bool out_of_turns = faction_a.active_members > 0
+                                  && faction_b.active_members > 0;
+
         // We bother with all this to properly deal with ties, and with
         // ball lightning or ballistomycete spores winning the fight via suicide.
         // The sanity checking is probably just paranoia.
         bool was_tied = false;
-        if (!faction_a.won && !faction_b.won)
+        if (out_of_turns)
+        {
+            faction_a.won = false;
+            faction_b.won = false;
+            ties++;
+            was_tied = true;
+        }
+        else if (!faction_a.won && !faction_b.won)
         {
             if (faction_a.active_members > 0)
             {
@@ -924,10 +985,16 @@ namespace arena
         else if (faction_a.won)
             team_a_wins++;
 
-        show_fight_banner(true);
+        round_results.push_back({was_tied ? 'T' : faction_a.won ? 'A' : 'B',
+                                 turns, fight_time.count()});
+
+        if (!batch)
+            show_fight_banner(true);
 
         string msg;
-        if (was_tied)
+        if (out_of_turns)
+            msg = make_stringf("Tie after %d turns", turns);
+        else if (was_tied)
             msg = "Tie";
         else
             msg = "Winner: %s!";
@@ -949,6 +1016,10 @@ namespace arena
         // parse_monster_spec and setup_fight will clear the rest.
         total_trials = trials_done = team_a_wins = ties = 0;
         contest_cancelled = false;
+        batch = false;
+        batch_jobs = 1;
+        turn_limit = 0;
+        round_results.clear();
         is_respawning = false;
         uniques_list.clear();
         memset(banned_glyphs, 0, sizeof(banned_glyphs));
@@ -1009,8 +1080,211 @@ namespace arena
         file = nullptr;
     }
 
+    /// @throws arena_error if a round couldn't be set up.
+    static void run_rounds(int first, int last)
+    {
+        // Rounds alternate which side is placed first, so keep the global
+        // round number.
+        trials_done = first;
+        while (trials_done < last && !contest_cancelled)
+        {
+            setup_fight();
+            do_fight();
+        }
+    }
+
+#ifdef UNIX
+    static string batch_file(int job)
+    {
+        return make_stringf("arena_job_%d.tmp", job);
+    }
+
+    static NORETURN void run_batch_job(int job, int jobs, uint64_t base_seed)
+    {
+        // The log belongs to the parent; don't interleave with it.
+        file = nullptr;
+        round_results.clear();
+        rng::seed(base_seed + job);
+
+        const int first = total_trials * job / jobs;
+        const int last = total_trials * (job + 1) / jobs;
+        try
+        {
+            run_rounds(first, last);
+        }
+        catch (const arena_error &error)
+        {
+            fprintf(stderr, "Arena job %d: %s\n", job, error.what());
+            _exit(1);
+        }
+        if (contest_cancelled)
+            _exit(1);
+
+        FILE *outf = fopen_u(batch_file(job).c_str(), "w");
+        if (!outf)
+            _exit(1);
+        for (const round_result &r : round_results)
+            fprintf(outf, "%c\t%d\t%.9f\n", r.winner, r.turns, r.seconds);
+        const bool written = !ferror(outf);
+        fclose(outf);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(written ? 0 : 1);
+    }
+
+    /// @throws arena_error if any job failed.
+    static void run_batch_jobs(int jobs)
+    {
+        const uint64_t base_seed = Options.seed ? Options.seed
+                                                : rng::get_uint64();
+        if (file != nullptr)
+            fflush(file);
+        fflush(stdout);
+        fflush(stderr);
+
+        vector<pid_t> workers;
+        for (int job = 0; job < jobs; ++job)
+        {
+            const pid_t pid = fork();
+            if (pid == -1)
+                break;
+            if (!pid)
+                run_batch_job(job, jobs, base_seed);
+            workers.push_back(pid);
+        }
+
+        int failed = jobs - workers.size();
+        for (pid_t pid : workers)
+        {
+            int status;
+            if (waitpid(pid, &status, 0) == -1
+                || !WIFEXITED(status) || WEXITSTATUS(status))
+            {
+                ++failed;
+            }
+        }
+
+        // Jobs hold consecutive rounds, so reading them in order keeps the
+        // rounds in order too.
+        for (int job = 0, size = workers.size(); job < size; ++job)
+        {
+            const string name = batch_file(job);
+            FILE *inf = fopen_u(name.c_str(), "r");
+            round_result r;
+            while (inf && fscanf(inf, " %c %d %lf", &r.winner, &r.turns,
+                                 &r.seconds) == 3)
+            {
+                round_results.push_back(r);
+            }
+            if (inf)
+                fclose(inf);
+            unlink_u(name.c_str());
+        }
+
+        if (failed)
+            throw arena_error_f("%d of %d arena jobs failed", failed, jobs);
+
+        trials_done = round_results.size();
+        team_a_wins = count_if(round_results.begin(), round_results.end(),
+                               [](const round_result &r)
+                               { return r.winner == 'A'; });
+        ties = count_if(round_results.begin(), round_results.end(),
+                        [](const round_result &r) { return r.winner == 'T'; });
+    }
+#endif
+
+    // Append one row per batch to arena.tsv, with a header for a new file,
+    // so that runs can be compared across versions.
+    static void write_batch_results(int jobs, double wall_seconds)
+    {
+        const char *out_file = "arena.tsv";
+        FILE *outf = fopen_u(out_file, "a");
+        if (!outf)
+            throw arena_error_f("Couldn't open %s", out_file);
+
+        if (!ftell(outf))
+        {
+            fprintf(outf, "version\tteams\tjobs\trounds\ta_wins\tb_wins"
+                    "\tties\ta_win_rate\tb_win_rate\ttie_rate\tturns"
+                    "\tturns_mean\tturns_min\tturns_max\tfight_seconds"
+                    "\tms_per_turn\twall_seconds\n");
+        }
+
+        const int rounds = round_results.size();
+        const int b_wins = rounds - team_a_wins - ties;
+        int64_t total_turns = 0;
+        int min_turns = rounds ? INT_MAX : 0, max_turns = 0;
+        double fight_seconds = 0;
+        for (const round_result &r : round_results)
+        {
+            total_turns += r.turns;
+            min_turns = min(min_turns, r.turns);
+            max_turns = max(max_turns, r.turns);
+            fight_seconds += r.seconds;
+        }
+        const double per_round = rounds ? 1.0 / rounds : 0;
+
+        fprintf(outf, "%s\t%s\t%d\t%d\t%d\t%d\t%d\t%.4f\t%.4f\t%.4f"
+                "\t%" PRId64 "\t%.2f\t%d\t%d\t%.3f\t%.4f\t%.3f\n",
+                Version::Long, teams.c_str(), jobs, rounds, team_a_wins,
+                b_wins, ties, team_a_wins * per_round, b_wins * per_round,
+                ties * per_round, total_turns, total_turns * per_round,
+                min_turns, max_turns, fight_seconds,
+                total_turns ? fight_seconds * 1000 / total_turns : 0.0,
+                wall_seconds);
+        fclose(outf);
+    }
+
+    /// @throws arena_error if the specification was invalid.
+    static void simulate_batch()
+    {
+        init_level_connectivity();
+
+        const int rounds = max(total_trials, 1);
+        total_trials = rounds;
+        int jobs = 1;
+#ifdef UNIX
+        jobs = min(batch_jobs, rounds);
+#endif
+
+        const auto start = chrono::steady_clock::now();
+#ifdef UNIX
+        if (jobs > 1)
+            run_batch_jobs(jobs);
+        else
+#endif
+            run_rounds(0, rounds);
+        if (contest_cancelled)
+            throw arena_error("Contest cancelled", false);
+        const chrono::duration<double> wall =
+            chrono::steady_clock::now() - start;
+
+        write_batch_results(jobs, wall.count());
+
+        mprf("---- Batch finished ----\n"
+             "Final score: %s (%d); %s (%d) [%d ties]",
+             faction_a.desc.c_str(), team_a_wins,
+             faction_b.desc.c_str(), trials_done - team_a_wins - ties, ties);
+        write_results();
+    }
+
     static void simulate()
     {
+        if (batch)
+        {
+            unwind_bool no_display(crawl_state.arena_batch, true);
+            try
+            {
+                simulate_batch();
+            }
+            catch (const arena_error &error)
+            {
+                write_error(error.what());
+                game_ended_with_error(error.what());
+            }
+            return;
+        }
+
         init_level_connectivity();
 
         class UIArena : public Box
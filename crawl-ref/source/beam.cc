@@ -2174,6 +2174,169 @@ int silver_damages_victim(actor* victim, int damage, string &dmg_msg)
     return ret;
 }
 
+static tracer_cache *active_tracers = nullptr;
+
+// Enough for every spell a monster knows, with room for retargeting.
+static const size_t MAX_CACHED_TRACERS = 24;
+
+tracer_cache::tracer_cache() : outer(active_tracers), stopped(false)
+{
+    active_tracers = this;
+}
+
+tracer_cache::~tracer_cache()
+{
+    stop();
+}
+
+void tracer_cache::stop()
+{
+    if (stopped)
+        return;
+
+    ASSERT(active_tracers == this);
+    active_tracers = outer;
+    entries.clear();
+    stopped = true;
+}
+
+tracer_cache *tracer_cache::active()
+{
+    return active_tracers;
+}
+
+// Chaos and random beams roll their flavour as they go, and rays chosen by
+// the caller or special explosions carry state that we don't compare. A
+// caster that can't see an invisible player fuzzes its target with a random
+// roll each time (fuzz_invis_tracer()), so those must be traced afresh.
+bool tracer_cache::cacheable(const bolt &pbolt)
+{
+    return !pbolt.chose_ray
+           && !pbolt.special_explosion
+           && pbolt.real_flavour != BEAM_CHAOS
+           && pbolt.real_flavour != BEAM_RANDOM
+           && (pbolt.can_see_invis || !you.invisible());
+}
+
+// Everything a tracer might read, or leave behind unchanged: if two bolts
+// agree on all of this, tracing them gives the same bolt back.
+bool tracer_cache::same_input(const bolt &a, const bolt &b)
+{
+    return a.origin_spell == b.origin_spell
+           && a.range == b.range
+           && a.glyph == b.glyph
+           && a.colour == b.colour
+           && a.flavour == b.flavour
+           && a.real_flavour == b.real_flavour
+           && a.drop_item == b.drop_item
+           && a.item_mulches == b.item_mulches
+           && a.item == b.item
+           && a.launcher == b.launcher
+           && a.source == b.source
+           && a.target == b.target
+           && a.damage.num == b.damage.num
+           && a.damage.size == b.damage.size
+           && a.ench_power == b.ench_power
+           && a.hit == b.hit
+           && a.thrower == b.thrower
+           && a.ex_size == b.ex_size
+           && a.source_id == b.source_id
+           && a.loudness == b.loudness
+           && a.pierce == b.pierce
+           && a.is_explosion == b.is_explosion
+           && a.is_death_effect == b.is_death_effect
+           && a.aimed_at_spot == b.aimed_at_spot
+           && a.affects_nothing == b.affects_nothing
+           && a.effect_known == b.effect_known
+           && a.effect_wanton == b.effect_wanton
+           && a.no_saving_throw == b.no_saving_throw
+           && a.draw_delay == b.draw_delay
+           && a.explode_delay == b.explode_delay
+           && a.redraw_per_cell == b.redraw_per_cell
+           && a.was_missile == b.was_missile
+           && a.animate == b.animate
+           && a.ac_rule == b.ac_rule
+#ifdef DEBUG_DIAGNOSTICS
+           && a.quiet_debug == b.quiet_debug
+#endif
+           && a.obvious_effect == b.obvious_effect
+           && a.seen == b.seen
+           && a.heard == b.heard
+           && a.extra_range_used == b.extra_range_used
+           && a.is_targeting == b.is_targeting
+           && a.aimed_at_feet == b.aimed_at_feet
+           && a.msg_generated == b.msg_generated
+           && a.noise_generated == b.noise_generated
+           && a.passed_target == b.passed_target
+           && a.attitude == b.attitude
+           && a.foe_ratio == b.foe_ratio
+           && a.beam_cancelled == b.beam_cancelled
+           && a.dont_stop_player == b.dont_stop_player
+           && a.overshoot_prompt == b.overshoot_prompt
+           && a.friendly_past_target == b.friendly_past_target
+           && a.bounces == b.bounces
+           && a.bounce_pos == b.bounce_pos
+           && a.reflections == b.reflections
+           && a.reflector == b.reflector
+           && a.use_target_as_pos == b.use_target_as_pos
+           && a.tile_beam == b.tile_beam
+           && a.can_see_invis == b.can_see_invis
+           && a.nightvision == b.nightvision
+           && a.can_trigger_bullseye == b.can_trigger_bullseye
+           && a.name == b.name
+           && a.short_name == b.short_name
+           && a.hit_verb == b.hit_verb
+           && a.source_name == b.source_name
+           && a.aux_source == b.aux_source
+           && a.hit_noise_msg == b.hit_noise_msg
+           && a.explode_noise_msg == b.explode_noise_msg
+           && a.path_taken == b.path_taken
+           && a.hit_count == b.hit_count;
+}
+
+bool tracer_cache::find(bolt &pbolt, bool explode_only,
+                        bool explosion_hole) const
+{
+    for (const entry &e : entries)
+    {
+        if (e.explode_only == explode_only
+            && e.explosion_hole == explosion_hole
+            && same_input(e.input, pbolt))
+        {
+            // The ray isn't compared, so leave the caller's alone.
+            const ray_def ray = pbolt.ray;
+            pbolt = e.result;
+            pbolt.ray = ray;
+            return true;
+        }
+    }
+    return false;
+}
+
+void tracer_cache::add(const bolt &input, const bolt &result,
+                       bool explode_only, bool explosion_hole)
+{
+    if (stopped)
+        return;
+
+    if (entries.size() >= MAX_CACHED_TRACERS)
+        entries.erase(entries.begin());
+    entries.push_back({input, result, explode_only, explosion_hole});
+}
+
+static void _fire_tracer_bolt(bolt &pbolt, bool explode_only,
+                              bool explosion_hole)
+{
+    // Fire!
+    if (explode_only)
+        pbolt.explode(false, explosion_hole);
+    else
+        pbolt.fire();
+
+    // Unset tracer flag (convenience).
+    pbolt.is_tracer = false;
+}
+
 //  Used by monsters in "planning" which spell to cast. Fires off a "tracer"
 //  which tells the monster what it'll hit if it breathes/casts etc.
 //
@@ -2217,14 +2380,19 @@ void fire_tracer(const monster* mons, bolt &pbolt, bool explode_only,
 
     pbolt.in_explosion_phase = false;
 
-    // Fire!
-    if (explode_only)
-        pbolt.explode(false, explosion_hole);
-    else
-        pbolt.fire();
+    tracer_cache *cache = tracer_cache::active();
+    if (!cache || !tracer_cache::cacheable(pbolt))
+    {
+        _fire_tracer_bolt(pbolt, explode_only, explosion_hole);
+        return;
+    }
 
-    // Unset tracer flag (convenience).
-    pbolt.is_tracer = false;
+    if (cache->find(pbolt, explode_only, explosion_hole))
+        return;
+
+    const bolt input = pbolt;
+    _fire_tracer_bolt(pbolt, explode_only, explosion_hole);
+    cache->add(input, pbolt, explode_only, explosion_hole);
 }
 
 set<coord_def> create_feat_splash(coord_def center,
@@ -52,6 +52,9 @@ struct tracer_info
     const tracer_info &operator += (const tracer_info &other);
 };
 
+// A field added here must also be compared in tracer_cache::same_input()
+// (beam.cc) if a tracer can read it, or the cache may hand back a stale
+// result.
 struct bolt
 {
     bolt();
@@ -179,6 +182,8 @@ private:
 
     bool can_trigger_bullseye = false;
 
+    friend class tracer_cache;
+
 public:
     bool is_enchantment() const; // no block/dodge, use willpower
     void set_target(const dist &targ);
@@ -353,6 +358,42 @@ bool curare_actor(actor* source, actor* target, string name,
 int silver_damages_victim(actor* victim, int damage, string &dmg_msg);
 void fire_tracer(const monster* mons, bolt &pbolt,
                   bool explode_only = false, bool explosion_hole = false);
+
+// While one of these is alive, fire_tracer() hands back what an identical
+// earlier tracer found instead of walking the ray again. Only keep one
+// around while nothing can move and no terrain can change, e.g. while a
+// monster is deciding what to cast.
+class tracer_cache
+{
+public:
+    tracer_cache();
+    ~tracer_cache();
+
+    // Forget everything and stop answering tracers.
+    void stop();
+
+    bool find(bolt &pbolt, bool explode_only, bool explosion_hole) const;
+    void add(const bolt &input, const bolt &result, bool explode_only,
+             bool explosion_hole);
+
+    static tracer_cache *active();
+    static bool cacheable(const bolt &pbolt);
+
+private:
+    struct entry
+    {
+        bolt input;
+        bolt result;
+        bool explode_only;
+        bool explosion_hole;
+    };
+
+    vector<entry> entries;
+    tracer_cache *outer;
+    bool stopped;
+
+    static bool same_input(const bolt &a, const bolt &b);
+};
 spret zapping(zap_type ztype, int power, bolt &pbolt,
                    bool needs_tracer = false, const char* msg = nullptr,
                    bool fail = false);
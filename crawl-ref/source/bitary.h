@@ -192,3 +192,64 @@ public:
         return *this;
     }
 };
+
+/**
+ * A set of indices below SIZE that can find its next member a word at a
+ * time, so walking a sparse set costs about SIZE / 64 plus its size.
+ */
+template <int SIZE> class FixedIndexSet
+{
+public:
+    FixedIndexSet()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (uint64_t &word : words)
+            word = 0;
+    }
+
+    void add(int i)
+    {
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    void remove(int i)
+    {
+        words[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+
+    bool contains(int i) const
+    {
+        return words[i / 64] >> (i % 64) & 1;
+    }
+
+    // The first member at or after i, or SIZE if there's none.
+    int next(int i) const
+    {
+        if (i >= SIZE)
+            return SIZE;
+        int w = i / 64;
+        uint64_t bits = words[w] >> (i % 64);
+        if (!bits)
+        {
+            do
+                if (++w == WORDS)
+                    return SIZE;
+            while (!words[w]);
+            bits = words[w];
+            i = w * 64;
+        }
+        while (!(bits & 0xFF))
+            bits >>= 8, i += 8;
+        while (!(bits & 1))
+            bits >>= 1, ++i;
+        return i;
+    }
+
+private:
+    static const int WORDS = (SIZE + 63) / 64;
+    uint64_t words[WORDS];
+};
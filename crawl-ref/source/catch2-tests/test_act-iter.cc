@@ -0,0 +1,112 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "act-iter.h"
+#include "env.h"
+
+// Puts a live monster straight into a slot, as far as the iterators care.
+static void _fake_monster(int i)
+{
+    env.mons[i].type = MONS_GOBLIN;
+    env.mons[i].hit_points = 1;
+    env.mons_used.add(i);
+}
+
+static void _clear_monsters()
+{
+    for (int i = 0; i < MAX_MONSTERS; ++i)
+    {
+        env.mons[i].type = MONS_NO_MONSTER;
+        env.mons[i].hit_points = 0;
+    }
+    env.mons_used.clear();
+}
+
+static vector<int> _iterated()
+{
+    vector<int> seen;
+    for (monster_iterator mi; mi; ++mi)
+        seen.push_back(mi->mindex());
+    return seen;
+}
+
+TEST_CASE( "Monster slots find the next slot in use", "[single-file]" ) {
+
+    monster_slots slots;
+    REQUIRE(slots.next(0) == MAX_MONSTERS);
+
+    for (int i : { 0, 63, 64, 200, MAX_MONSTERS - 1 })
+        slots.add(i);
+
+    REQUIRE(slots.next(0) == 0);
+    REQUIRE(slots.next(1) == 63);
+    REQUIRE(slots.next(64) == 64);
+    REQUIRE(slots.next(65) == 200);
+    REQUIRE(slots.next(201) == MAX_MONSTERS - 1);
+    REQUIRE(slots.next(MAX_MONSTERS) == MAX_MONSTERS);
+
+    slots.remove(63);
+    REQUIRE_FALSE(slots.contains(63));
+    REQUIRE(slots.next(1) == 64);
+}
+
+TEST_CASE( "Monster iterators only visit live monsters", "[single-file]" ) {
+
+    _clear_monsters();
+    for (int i : { 3, 70, 71, 500 })
+        _fake_monster(i);
+
+    SECTION ("in slot order") {
+        REQUIRE(_iterated() == vector<int>({ 3, 70, 71, 500 }));
+    }
+
+    SECTION ("skipping monsters that died but haven't been reset") {
+        env.mons[70].hit_points = 0;
+        REQUIRE(_iterated() == vector<int>({ 3, 71, 500 }));
+    }
+
+    SECTION ("including monsters placed after the current one") {
+        vector<int> seen;
+        for (monster_iterator mi; mi; ++mi)
+        {
+            seen.push_back(mi->mindex());
+            if (mi->mindex() == 71)
+            {
+                _fake_monster(2);
+                _fake_monster(300);
+            }
+        }
+        REQUIRE(seen == vector<int>({ 3, 70, 71, 300, 500 }));
+    }
+
+    _clear_monsters();
+}
+
+// A sparse level: a few dozen monsters in the low slots, as get_free_monster()
+// hands them out. Compare against checking every slot, as iterators used to.
+TEST_CASE( "Benchmark iterating over monsters", "[.benchmark]" ) {
+
+    _clear_monsters();
+    for (int i = 0; i < 60; i += 2)
+        _fake_monster(i);
+
+    BENCHMARK("monster_iterator")
+    {
+        int n = 0;
+        for (monster_iterator mi; mi; ++mi)
+            n += mi->hit_points;
+        return n;
+    };
+
+    BENCHMARK("scanning every slot")
+    {
+        int n = 0;
+        for (int i = 0; i < MAX_MONSTERS; ++i)
+            if (env.mons[i].alive())
+                n += env.mons[i].hit_points;
+        return n;
+    };
+
+    _clear_monsters();
+}
@@ -0,0 +1,34 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "beam.h"
+#include "player.h"
+
+#include "test_player_fixture.h"
+
+TEST_CASE_METHOD(MockPlayerYouTestsFixture,
+                 "Tracers that roll dice are never shared", "[single-file]") {
+
+    bolt beam;
+    beam.flavour = beam.real_flavour = BEAM_FIRE;
+    REQUIRE(tracer_cache::cacheable(beam));
+
+    SECTION ("chaos and random beams") {
+        beam.real_flavour = BEAM_CHAOS;
+        REQUIRE_FALSE(tracer_cache::cacheable(beam));
+        beam.real_flavour = BEAM_RANDOM;
+        REQUIRE_FALSE(tracer_cache::cacheable(beam));
+    }
+
+    SECTION ("aiming at an invisible player") {
+        you.duration[DUR_INVIS] = 10;
+        REQUIRE(you.invisible());
+
+        // With no agent the bolt can't see invisible, so fuzz_invis_tracer()
+        // would move its target by a random offset each time.
+        REQUIRE_FALSE(tracer_cache::cacheable(beam));
+
+        you.duration[DUR_INVIS] = 0;
+    }
+}
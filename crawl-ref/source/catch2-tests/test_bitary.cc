@@ -0,0 +1,66 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "bitary.h"
+
+static vector<int> _members(const FixedIndexSet<GXM * GYM> &set)
+{
+    vector<int> found;
+    for (int i = set.next(0); i < GXM * GYM; i = set.next(i + 1))
+        found.push_back(i);
+    return found;
+}
+
+TEST_CASE( "Index sets walk their members in order", "[single-file]" ) {
+
+    FixedIndexSet<GXM * GYM> set;
+    REQUIRE(_members(set).empty());
+
+    for (int i : { GXM * GYM - 1, 200, 64, 63, 0 })
+        set.add(i);
+    REQUIRE(_members(set) == vector<int>({ 0, 63, 64, 200, GXM * GYM - 1 }));
+
+    SECTION ("removing and re-adding") {
+        set.remove(64);
+        set.add(63);
+        REQUIRE_FALSE(set.contains(64));
+        REQUIRE(_members(set) == vector<int>({ 0, 63, 200, GXM * GYM - 1 }));
+    }
+
+    SECTION ("clearing") {
+        set.clear();
+        REQUIRE(_members(set).empty());
+    }
+}
+
+// A quiet turn on an explored level, as far as webtiles' dirty cells go: one
+// monster moved, so its old and new cells need sending. Compare against
+// testing every cell of the map, as _send_map() used to.
+TEST_CASE( "Benchmark finding the dirty cells of a quiet turn", "[.benchmark]" ) {
+
+    FixedIndexSet<GXM * GYM> dirty;
+    bitset<GXM * GYM> dirty_bits;
+    for (int i : { 35 * GXM + 40, 35 * GXM + 41 })
+    {
+        dirty.add(i);
+        dirty_bits[i] = true;
+    }
+
+    BENCHMARK("FixedIndexSet")
+    {
+        int sum = 0;
+        for (int i = dirty.next(0); i < GXM * GYM; i = dirty.next(i + 1))
+            sum += i;
+        return sum;
+    };
+
+    BENCHMARK("testing every cell")
+    {
+        int sum = 0;
+        for (int i = 0; i < GXM * GYM; i++)
+            if (dirty_bits[i])
+                sum += i;
+        return sum;
+    };
+}
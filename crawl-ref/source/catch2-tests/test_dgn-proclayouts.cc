@@ -0,0 +1,78 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "dgn-proclayouts.h"
+#include "perlin.h"
+
+// The same stack as the Abyss uses, bar the level it mixes in.
+static const ColumnLayout columns(2);
+static const ColumnLayout col_space(2, 3);
+static const ClampLayout clamp_columns(columns, 5, true);
+static const RoilingChaosLayout chaos(8675309, 450);
+static const NewAbyssLayout new_abyss(7629);
+static const ProceduralLayout* mixed_layouts[] =
+{
+    &chaos, &clamp_columns, &new_abyss, &col_space,
+};
+static const WorleyLayout mixed(4321,
+    vector<const ProceduralLayout*>(mixed_layouts,
+                                    mixed_layouts + ARRAYSZ(mixed_layouts)));
+static const ProceduralLayout* base_layouts[] = { &new_abyss, &mixed };
+static const WorleyLayout base(314159,
+    vector<const ProceduralLayout*>(base_layouts,
+                                    base_layouts + ARRAYSZ(base_layouts)),
+    5.0);
+static const RiverLayout rivers(1800, base);
+
+TEST_CASE( "Batched layout samples match single ones", "[single-file]" ) {
+
+    const uint32_t offsets[] = { 0, 4567, 1234567, 0x7FFFFFFF };
+    const ProceduralLayout* layouts[] = { &chaos, &new_abyss, &mixed,
+                                          &rivers };
+
+    for (const uint32_t offset : offsets)
+        for (const ProceduralLayout* layout : layouts)
+        {
+            // A few rows, like _abyss_apply_terrain() asks for, from the
+            // far corner of the abyss coordinates too.
+            vector<coord_def> ps;
+            for (int y = 0; y < 3; ++y)
+                for (int x = 0; x < GXM; ++x)
+                {
+                    ps.emplace_back(x + 1000, y + 2000);
+                    ps.emplace_back(x + 0x7FFF0000, y + 0x7FFF0000);
+                }
+
+            vector<ProceduralSample> samples;
+            layout->sample_all(ps, offset, samples);
+            REQUIRE(samples.size() == ps.size());
+            for (size_t i = 0; i < ps.size(); ++i)
+            {
+                const ProceduralSample single = (*layout)(ps[i], offset);
+                REQUIRE(samples[i].coord() == ps[i]);
+                REQUIRE(samples[i].feat() == single.feat());
+                REQUIRE(samples[i].changepoint() == single.changepoint());
+            }
+        }
+}
+
+TEST_CASE( "Batched fBM matches single points exactly", "[single-file]" ) {
+
+    vector<double> xs, ys;
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 20; ++x)
+        {
+            xs.push_back(x / 4.0 + 3.7);
+            ys.push_back((y % 2) * 7.5 + 1.9);
+        }
+    vector<double> out(xs.size());
+
+    for (uint32_t octaves = 1; octaves <= 5; ++octaves)
+    {
+        perlin::fBM(xs.data(), ys.data(), 1804, octaves, xs.size(),
+                    out.data());
+        for (size_t i = 0; i < xs.size(); ++i)
+            REQUIRE(out[i] == perlin::fBM(xs[i], ys[i], 1804, octaves));
+    }
+}
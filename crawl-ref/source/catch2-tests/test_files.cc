@@ -24,7 +24,7 @@ TEST_CASE( "Test save version reading/writing works", "[single-file]" ) {
             vector<unsigned char> output;
             vector<unsigned char> expected_output = { 0xff, 0x00, };
             const auto version = save_version(255, 0);
-            auto w = writer(&output);
+            writer w(&output);
 
             write_save_version(w, version);
 
@@ -48,7 +48,7 @@ TEST_CASE( "Test save version reading/writing works", "[single-file]" ) {
             vector<unsigned char> output;
             vector<unsigned char> expected_output = { 0x00, 0xfe, };
             const auto version = save_version(0, 254);
-            auto w = writer(&output);
+            writer w(&output);
 
             write_save_version(w, version);
 
@@ -73,7 +73,7 @@ TEST_CASE( "Test save version reading/writing works", "[single-file]" ) {
             vector<unsigned char> output;
             vector<unsigned char> expected_output = { 0x00, 0xff, 0x01, 0x02, 0x03, 0x04 };
             const auto version = save_version(0, (1 << 24) + (2 << 16) + (3 << 8) + 4);
-            auto w = writer(&output);
+            writer w(&output);
 
             write_save_version(w, version);
 
@@ -89,7 +89,7 @@ TEST_CASE( "Test save version reading/writing works", "[single-file]" ) {
             const auto version = save_version(random2(255), random2(1000));
 
             vector<unsigned char> buf;
-            auto w = writer(&buf);
+            writer w(&buf);
             write_save_version(w, version);
 
             auto r = reader(buf);
@@ -5,8 +5,10 @@
 #include "artefact.h"
 #include "art-enum.h"
 #include "items.h"
+#include "item-name.h"
 #include "item-prop.h"
 #include "item-prop-enum.h"
+#include "item-status-flag-type.h"
 #include "invent.h"
 #include "player-equip.h"
 #include "potion-type.h"
@@ -216,3 +218,78 @@ TEST_CASE("Test all_item_subtypes() does include items for each category",
     REQUIRE(all_item_subtypes(OBJ_TALISMANS).size() > 0);
     REQUIRE(all_item_subtypes(OBJ_GEMS).size() > 0);
 }
+
+TEST_CASE_METHOD( MockPlayerYouTestsFixture,
+                  "Item names follow identification and item changes",
+                  "[single-file]" ) {
+
+    item_def potion = simple_create_item(OBJ_POTIONS, POT_CURING);
+    potion.subtype_rnd = 17;
+    potion.pos = coord_def(10, 10);
+
+    you.type_ids[OBJ_POTIONS][POT_CURING] = false;
+    const string unknown = potion.name(DESC_A);
+    REQUIRE(unknown != "a potion of curing");
+    REQUIRE(potion.name(DESC_A) == unknown);
+
+    you.type_ids[OBJ_POTIONS][POT_CURING] = true;
+    REQUIRE(potion.name(DESC_A) == "a potion of curing");
+    REQUIRE(potion.name(DESC_PLAIN) == "potion of curing");
+
+    potion.quantity = 3;
+    REQUIRE(potion.name(DESC_A) == "3 potions of curing");
+    potion.inscription = "heal";
+    REQUIRE(potion.name(DESC_A) == "3 potions of curing {heal}");
+    REQUIRE(potion.name(DESC_A, false, false, false)
+            == "3 potions of curing");
+
+    you.type_ids[OBJ_POTIONS][POT_CURING] = false;
+    REQUIRE(potion.name(DESC_A, false, false, false) != "3 potions of curing");
+
+    item_def dagger = simple_create_item(OBJ_WEAPONS, WPN_DAGGER, 2);
+    dagger.pos = coord_def(10, 10);
+    REQUIRE(dagger.name(DESC_A) == "a dagger");
+    dagger.flags |= ISFLAG_KNOW_PLUSES;
+    REQUIRE(dagger.name(DESC_A) == "a +2 dagger");
+    dagger.plus = 3;
+    REQUIRE(dagger.name(DESC_A) == "a +3 dagger");
+}
+
+TEST_CASE_METHOD( MockPlayerYouTestsFixture,
+                  "Benchmark naming a full pack and a pile of floor items",
+                  "[.benchmark]" ) {
+
+    const object_class_type classes[] = { OBJ_POTIONS, OBJ_SCROLLS,
+                                          OBJ_WEAPONS, OBJ_ARMOUR };
+    vector<item_def> floor;
+    for (int i = 0; i < ENDOFPACK; ++i)
+    {
+        const object_class_type base = classes[i % ARRAYSZ(classes)];
+        const auto subtypes = all_item_subtypes(base);
+        item_def item = simple_create_item(base,
+                                           subtypes[i % subtypes.size()]);
+        floor.push_back(item);
+        floor.back().pos = coord_def(10, 10);
+        move_item_to_inv(item);
+    }
+
+    BENCHMARK("inventory redraw")
+    {
+        size_t length = 0;
+        for (const item_def &item : you.inv)
+            if (item.defined())
+            {
+                length += item.name(DESC_INVENTORY).length();
+                length += menu_colour_item_name(item, DESC_PLAIN).length();
+            }
+        return length;
+    };
+
+    BENCHMARK("autopickup checks")
+    {
+        int wanted = 0;
+        for (const item_def &item : floor)
+            wanted += item_needs_autopickup(item);
+        return wanted;
+    };
+}
@@ -0,0 +1,62 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "map-cell.h"
+#include "mon-info.h"
+#include "monster.h"
+
+// What _update_monster() builds for an orc priest with a weapon and armour.
+static monster_info _orc_priest()
+{
+    monster_info mi;
+    mi.type = MONS_ORC_PRIEST;
+    mi.props[KNOWN_MAX_HP_KEY] = 15;
+    mi.props[PRIEST_KEY] = true;
+    mi.props[ACTUAL_SPELLCASTER_KEY] = true;
+    for (int i = 0; i < 4; ++i)
+        mi.spells.push_back({ SPELL_PAIN, 30, MON_SPELL_PRIEST });
+    mi.inv[MSLOT_WEAPON].reset(new item_def());
+    mi.inv[MSLOT_ARMOUR].reset(new item_def());
+    return mi;
+}
+
+TEST_CASE( "Monster info is moved into map knowledge", "[single-file]" ) {
+
+    monster_info mi = _orc_priest();
+    const item_def *weapon = mi.inv[MSLOT_WEAPON].get();
+
+    SECTION ("moving hands over the inventory") {
+        map_cell cell;
+        cell.set_monster(move(mi));
+        REQUIRE(cell.monsterinfo()->inv[MSLOT_WEAPON].get() == weapon);
+        REQUIRE(cell.monsterinfo()->props[PRIEST_KEY].get_bool());
+        REQUIRE(cell.monsterinfo()->spells.size() == 4);
+    }
+
+    SECTION ("copying still duplicates it") {
+        map_cell cell;
+        cell.set_monster(mi);
+        REQUIRE(cell.monsterinfo()->inv[MSLOT_WEAPON].get() != weapon);
+        REQUIRE(mi.inv[MSLOT_WEAPON].get() == weapon);
+        REQUIRE(cell.monsterinfo()->props[PRIEST_KEY].get_bool());
+    }
+}
+
+// Run with "[.benchmark]". The cost of filling in map knowledge for one
+// monster in view, with and without the copy _update_monster() used to make.
+TEST_CASE( "Benchmark storing monster info", "[.benchmark]" ) {
+
+    map_cell cell;
+
+    BENCHMARK("copy")
+    {
+        const monster_info mi = _orc_priest();
+        cell.set_monster(mi);
+    };
+
+    BENCHMARK("move")
+    {
+        cell.set_monster(_orc_priest());
+    };
+}
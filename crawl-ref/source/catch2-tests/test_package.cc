@@ -0,0 +1,278 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include <cstdlib>
+#include <sys/resource.h>
+
+#include "package.h"
+#include "tags.h"
+
+static vector<char> _test_data(size_t len, unsigned seed)
+{
+    // Something that compresses, but not down to nothing.
+    vector<char> data(len);
+    for (size_t i = 0; i < len; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = i % 7 ? i % 13 : seed >> 16;
+    }
+    return data;
+}
+
+static vector<char> _read_chunk(package &pkg, const string &name)
+{
+    chunk_reader rd(&pkg, name);
+    vector<char> data;
+    rd.read_all(data);
+    return data;
+}
+
+TEST_CASE( "Save package chunks survive a round trip", "[single-file]" ) {
+
+    const int threads = GENERATE(0, 2);
+    const bool mmap = GENERATE(false, true);
+    package::set_compression_threads(threads);
+    package::set_mmap(mmap);
+
+    // Empty, tiny, exactly one compression segment, and several segments.
+    const vector<size_t> sizes = { 0, 1, 131072, 131073, 1000000 };
+
+    package pkg;
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        const vector<char> data = _test_data(sizes[i], i);
+        chunk_writer *wr = pkg.writer(to_string(i));
+        if (!data.empty())
+            wr->write(&data[0], data.size());
+        delete wr;
+    }
+
+    SECTION ("chunks can be read before the package is committed") {
+        REQUIRE(pkg.has_chunk("1"));
+        REQUIRE(_read_chunk(pkg, "1") == _test_data(sizes[1], 1));
+    }
+
+    SECTION ("chunks can be read after the package is committed") {
+        pkg.commit();
+        for (size_t i = 0; i < sizes.size(); ++i)
+            REQUIRE(_read_chunk(pkg, to_string(i)) == _test_data(sizes[i], i));
+    }
+
+    SECTION ("readers survive the file growing under them") {
+        chunk_reader rd(&pkg, "4");
+        char head[16];
+        REQUIRE(rd.read(head, sizeof(head)) == sizeof(head));
+
+        const vector<char> data = _test_data(2000000, 7);
+        chunk_writer *wr = pkg.writer("5");
+        wr->write(&data[0], data.size());
+        delete wr;
+        REQUIRE(_read_chunk(pkg, "5") == data);
+
+        vector<char> rest;
+        rd.read_all(rest);
+        REQUIRE(rest.size() + sizeof(head) == sizes[4]);
+    }
+
+    SECTION ("chunks rewritten before a commit keep the last write") {
+        const vector<char> data = _test_data(300000, 42);
+        for (int i = 0; i < 2; ++i)
+        {
+            chunk_writer *wr = pkg.writer("3");
+            wr->write(&data[0], data.size());
+            delete wr;
+        }
+        pkg.delete_chunk("4");
+        pkg.commit();
+
+        REQUIRE(_read_chunk(pkg, "3") == data);
+        REQUIRE_FALSE(pkg.has_chunk("4"));
+    }
+
+    package::set_compression_threads(0);
+    package::set_mmap(false);
+}
+
+TEST_CASE( "Delta saves store only what changed", "[single-file]" ) {
+
+    package::set_delta_saves(true);
+
+    package pkg;
+    vector<char> data = _test_data(1000000, 1);
+    auto write = [&pkg](const vector<char> &d)
+    {
+        chunk_writer *wr = pkg.writer("you");
+        wr->write(&d[0], d.size());
+        delete wr;
+    };
+    write(data);
+    pkg.commit();
+    const plen_t full_len = pkg.get_chunk_compressed_length("you");
+    const plen_t size = pkg.get_size();
+
+    SECTION ("unchanged chunks aren't rewritten") {
+        write(data);
+        pkg.commit();
+        REQUIRE(pkg.get_size() == size);
+    }
+
+    SECTION ("small changes are stored as a delta") {
+        data[12345] ^= 1;
+        data[800000] ^= 1;
+        write(data);
+        REQUIRE(_read_chunk(pkg, "you") == data);
+        pkg.commit();
+        REQUIRE(pkg.get_chunk_compressed_length("you") < full_len + full_len / 10);
+
+        data.resize(1004321, 'x');
+        write(data);
+        REQUIRE(_read_chunk(pkg, "you") == data);
+        data.resize(900000);
+        write(data);
+        REQUIRE(_read_chunk(pkg, "you") == data);
+    }
+
+    SECTION ("compacting folds the deltas back") {
+        data[5] ^= 1;
+        write(data);
+        pkg.compact();
+        pkg.commit();
+        REQUIRE(pkg.get_chunk_fragmentation("you") == 1);
+        REQUIRE(_read_chunk(pkg, "you") == data);
+    }
+
+    SECTION ("deltas are taken against the last full write") {
+        data[12345] ^= 1;
+        write(data);
+        data[12345] ^= 1;
+        data[600000] ^= 1;
+        write(data);
+        REQUIRE(_read_chunk(pkg, "you") == data);
+        data[600000] ^= 1;
+        write(data);
+        pkg.commit();
+        REQUIRE(_read_chunk(pkg, "you") == data);
+    }
+
+    SECTION ("deltas can follow a full write still being deflated") {
+        package::set_compression_threads(2);
+        data = _test_data(1000000, 3);
+        write(data);
+        data[777] ^= 1;
+        write(data);
+        pkg.commit();
+        REQUIRE(_read_chunk(pkg, "you") == data);
+        package::set_compression_threads(0);
+    }
+
+    SECTION ("large changes are written in full") {
+        data = _test_data(1000000, 2);
+        write(data);
+        REQUIRE(_read_chunk(pkg, "you") == data);
+    }
+
+    package::set_delta_saves(false);
+}
+
+// Set CRAWL_BENCH_SAVE to the path of a (preferably late-game) save file,
+// and run with "[.benchmark]". The save is only read; its chunks are written
+// into a temporary package, as save_game() would do.
+TEST_CASE( "Benchmark saving a character", "[.benchmark]" ) {
+
+    const char *save = getenv("CRAWL_BENCH_SAVE");
+    if (!save)
+    {
+        WARN("CRAWL_BENCH_SAVE is not set, skipping");
+        return;
+    }
+
+    vector<pair<string, vector<char>>> chunks;
+    {
+        package src(save, false);
+        for (const string &name : src.list_chunks())
+            chunks.emplace_back(name, _read_chunk(src, name));
+    }
+
+    auto write_all = [&chunks](package &pkg)
+    {
+        for (const auto &ch : chunks)
+        {
+            chunk_writer *wr = pkg.writer(ch.first);
+            // writer::writeByte() hands the data over byte by byte
+            for (const char c : ch.second)
+                wr->write(&c, 1);
+            delete wr;
+        }
+    };
+
+    for (int threads : { 0, 4 })
+    {
+        package::set_compression_threads(threads);
+        const string desc = threads ? to_string(threads) + " threads"
+                                    : string("inline");
+
+        BENCHMARK_ADVANCED("game thread, " + desc)(Catch::Benchmark::Chronometer meter)
+        {
+            // The packages are committed when they go away, untimed.
+            vector<unique_ptr<package>> pkgs(meter.runs());
+            for (auto &pkg : pkgs)
+                pkg.reset(new package());
+            meter.measure([&](int i) { write_all(*pkgs[i]); });
+        };
+
+        BENCHMARK("wall time with commit, " + desc)
+        {
+            package pkg;
+            write_all(pkg);
+            pkg.commit();
+        };
+    }
+
+    package::set_compression_threads(0);
+}
+
+static long _peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// As above; reads every chunk of the save the way load_level() does.
+TEST_CASE( "Benchmark loading a character", "[.benchmark]" ) {
+
+    const char *save = getenv("CRAWL_BENCH_SAVE");
+    if (!save)
+    {
+        WARN("CRAWL_BENCH_SAVE is not set, skipping");
+        return;
+    }
+
+    for (bool mmap : { false, true })
+    {
+        package::set_mmap(mmap);
+        const string desc = mmap ? "mmap" : "read()";
+
+        package pkg(save, false);
+        const vector<string> chunks = pkg.list_chunks();
+
+        BENCHMARK("load all chunks, " + desc)
+        {
+            size_t total = 0;
+            for (const string &name : chunks)
+            {
+                reader inf(&pkg, name);
+                while (inf.valid())
+                {
+                    inf.readByte();
+                    total++;
+                }
+            }
+            return total;
+        };
+        WARN("peak RSS after " << desc << ": " << _peak_rss_kb() << " KB");
+    }
+
+    package::set_mmap(false);
+}
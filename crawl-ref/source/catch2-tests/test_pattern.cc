@@ -0,0 +1,231 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "pattern.h"
+#include "stringutil.h"
+
+// The sort of thing found in a big rc file: force_more_message and
+// autopickup_exceptions lines, one per monster or item of interest.
+static vector<string> _heavy_rc_patterns()
+{
+    const char *names[] = {
+        "orb of fire", "ancient lich", "dread lich", "juggernaut",
+        "tentacled monstrosity", "shard shrike", "hellion", "tormentor",
+        "moth of wrath", "curse toe", "greater mummy", "lernaean hydra",
+        "royal jelly", "doom hound", "caustic shrike", "iron giant",
+        "draconian scorcher", "deep elf annihilator", "ice statue",
+        "orange crystal statue", "glowing orange brain", "vault sentinel",
+        "sphinx", "shadow dragon", "golden dragon", "quicksilver dragon",
+        "storm dragon", "titan", "fire giant", "frost giant", "stone giant",
+        "cacodemon", "brimstone fiend", "ice fiend", "hell sentinel",
+        "shadow fiend", "executioner", "blizzard demon", "green death",
+        "balrug", "reaper", "soul eater", "smoke demon", "sun demon",
+        "neqoxec", "ynoxinul", "lorocyproca", "tengu reaver", "naga sharpshooter",
+    };
+
+    vector<string> patterns;
+    for (const char *name : names)
+    {
+        patterns.push_back(make_stringf("\\b%s\\b.*comes? into view", name));
+        patterns.push_back(make_stringf("^%s (is|are) (nearby|close)", name));
+        patterns.push_back(make_stringf("You (kill|destroy) the %s", name));
+        patterns.push_back(make_stringf("<%s", name));
+    }
+    const char *items[] = {
+        "potions? of (heal wounds|haste)", "scrolls? of (blinking|fog)",
+        "wand of", "ring of", "amulet of", "manual of", "book of",
+        "(?:useless|evil_item)", "\\.\\.\\.", "^(?!.*cursed).*rune",
+        "dangerous_item", "[Bb]olts?", "darts?", "stones?", "boomerangs?",
+    };
+    for (const char *item : items)
+        for (int i = 0; i < 10; ++i)
+            patterns.push_back(make_stringf("%s.*%d", item, i));
+    return patterns;
+}
+
+static const vector<string> _messages = {
+    "An ancient lich comes into view.",
+    "You kill the goblin!",
+    "You see here 3 scrolls of blinking.",
+    "The orc hits you.",
+    "You feel a bit more experienced.",
+    "Things that are here: a +0 ring of protection from fire",
+    "A shadow dragon is nearby!",
+    "You destroy the ice statue!",
+    "The hellion breathes hellfire at you.",
+};
+
+TEST_CASE( "Required literals are found conservatively", "[single-file]" ) {
+
+    SECTION ("plain text is required, case folded") {
+        REQUIRE(pattern_required_literal("Comes into view", false)
+                == "comes into view");
+        REQUIRE(pattern_required_literal("^You kill .* orc$", false)
+                == "you kill ");
+    }
+
+    SECTION ("optional characters are dropped") {
+        REQUIRE(pattern_required_literal("scrolls? of", false) == "scroll");
+        REQUIRE(pattern_required_literal("aaab*", false) == "aaa");
+        REQUIRE(pattern_required_literal("abc{0,1}", false) == "ab");
+        REQUIRE(pattern_required_literal("abc+*", false) == "ab");
+    }
+
+    SECTION ("groups, brackets and escapes aren't literal") {
+        REQUIRE(pattern_required_literal("(long group text)?ab", false) == "ab");
+        REQUIRE(pattern_required_literal("[abcdefgh]xy", false) == "xy");
+        REQUIRE(pattern_required_literal("[]abcdefgh]xy", false) == "xy");
+        REQUIRE(pattern_required_literal("\\bwand\\b", false) == "wand");
+    }
+
+    SECTION ("some patterns have nothing that is certainly required") {
+        REQUIRE(pattern_required_literal("foo|bar", false) == "");
+        REQUIRE(pattern_required_literal("(?i)foo", false) == "");
+        REQUIRE(pattern_required_literal("\\Qa.b\\E", false) == "");
+        REQUIRE(pattern_required_literal("[[:alpha:]]+", false) == "");
+        REQUIRE(pattern_required_literal(".*", false) == "");
+    }
+
+    SECTION ("escapes longer than one character give up") {
+        REQUIRE(pattern_required_literal("\\x41bc", false) == "");
+        REQUIRE(pattern_required_literal("\\101x", false) == "");
+        REQUIRE(pattern_required_literal("\\x{263a}", false) == "");
+        REQUIRE(pattern_required_literal("\\p{Lu}orc", false) == "");
+        REQUIRE(pattern_required_literal("(a)bc\\1", false) == "");
+        REQUIRE(pattern_required_literal("ab\\.cd", false) == "ab");
+    }
+
+    SECTION ("non-ASCII text is only used when case matters") {
+        REQUIRE(pattern_required_literal("caf\xc3\xa9", false)
+                == "caf\xc3\xa9");
+        REQUIRE(pattern_required_literal("caf\xc3\xa9", true) == "caf");
+        REQUIRE(pattern_required_literal("ab\xc3\xa9?", false) == "ab");
+    }
+}
+
+TEST_CASE( "Pattern sets match like their patterns", "[single-file]" ) {
+
+    pattern_set set;
+    vector<text_pattern> patterns;
+    for (const string &p : _heavy_rc_patterns())
+    {
+        patterns.emplace_back(p, true);
+        set.add(patterns.back());
+    }
+    REQUIRE(set.size() == patterns.size());
+
+    for (const string &message : _messages)
+    {
+        vector<int> expected;
+        for (int i = 0, size = patterns.size(); i < size; ++i)
+            if (patterns[i].matches(message))
+                expected.push_back(i);
+
+        REQUIRE(set.matches(message) == expected);
+        REQUIRE(set.first_match(message)
+                == (expected.empty() ? -1 : expected[0]));
+    }
+
+    SECTION ("callers can add their own conditions") {
+        const string message = "You see here a wand of digging (7) and darts (7).";
+        const vector<int> expected = set.matches(message);
+        REQUIRE(expected.size() == 2);
+        const int second = set.first_match(message, [&](int i)
+            {
+                return i != expected[0] && patterns[i].matches(message);
+            });
+        REQUIRE(second == expected[1]);
+    }
+
+    SECTION ("cleared sets match nothing") {
+        set.clear();
+        REQUIRE(set.empty());
+        REQUIRE(set.first_match(_messages[0]) == -1);
+    }
+}
+
+TEST_CASE( "Literal indexes find every string with the literal", "[single-file]" ) {
+
+    literal_index index;
+    for (const string &message : _messages)
+        index.add(message);
+    REQUIRE(index.size() == (int) _messages.size());
+
+    const char *literals[] = { "comes into view", "you ", "ICE", "the",
+                               "scrolls of blink", "zzz", "xe", "" };
+    for (const char *literal : literals)
+    {
+        vector<bool> maybe;
+        index.candidates(literal, maybe);
+        REQUIRE(maybe.size() == _messages.size());
+        for (size_t i = 0; i < _messages.size(); ++i)
+        {
+            if (lowercase_string(_messages[i]).find(literal)
+                != string::npos)
+            {
+                REQUIRE(maybe[i]);
+            }
+        }
+    }
+
+    SECTION ("long literals narrow things down") {
+        vector<bool> maybe;
+        index.candidates("shadow dragon", maybe);
+        REQUIRE(count(maybe.begin(), maybe.end(), true) == 1);
+        REQUIRE(maybe[6]);
+
+        index.candidates("no such thing", maybe);
+        REQUIRE(count(maybe.begin(), maybe.end(), true) == 0);
+    }
+
+    SECTION ("patterns know their literals") {
+        REQUIRE(text_pattern("Scrolls? of", true).required_literal()
+                == "scroll");
+        REQUIRE(plaintext_pattern("Wand of", true).required_literal()
+                == "wand of");
+        REQUIRE(plaintext_pattern("caf\xc3\xa9s", true).required_literal()
+                == "caf");
+        REQUIRE(plaintext_pattern("caf\xc3\xa9s", false).required_literal()
+                == "caf\xc3\xa9s");
+    }
+}
+
+TEST_CASE( "Benchmark matching messages against a heavy rc file", "[.benchmark]" ) {
+
+    pattern_set set;
+    vector<text_pattern> patterns;
+    for (const string &p : _heavy_rc_patterns())
+    {
+        patterns.emplace_back(p, true);
+        set.add(patterns.back());
+    }
+    // Compile everything up front, as a game in progress would have.
+    for (const string &message : _messages)
+    {
+        set.matches(message);
+        for (const text_pattern &pattern : patterns)
+            pattern.matches(message);
+    }
+
+    BENCHMARK("each pattern in turn")
+    {
+        int found = 0;
+        for (const string &message : _messages)
+            for (const text_pattern &pattern : patterns)
+                if (pattern.matches(message))
+                {
+                    ++found;
+                    break;
+                }
+        return found;
+    };
+
+    BENCHMARK("pattern_set")
+    {
+        int found = 0;
+        for (const string &message : _messages)
+            found += set.first_match(message) >= 0;
+        return found;
+    };
+}
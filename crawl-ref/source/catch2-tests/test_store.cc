@@ -0,0 +1,141 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "store.h"
+#include "stringutil.h"
+#include "tags.h"
+
+TEST_CASE( "Hash tables find keys however they are named", "[single-file]" ) {
+
+    CrawlHashTable props;
+    props["alpha"] = 1;
+    props[string("beta")] = 2;
+
+    SECTION ("keys with the same name are the same key") {
+        REQUIRE(prop_key("alpha") == prop_key(string("alpha")));
+        REQUIRE(prop_key("alpha") != prop_key("beta"));
+        REQUIRE(prop_key("alpha").name() == "alpha");
+    }
+
+    SECTION ("only literal names are interned") {
+        REQUIRE(prop_key("alpha").interned());
+        REQUIRE(prop_key(string("alpha")).interned());
+        const prop_key made(make_stringf("made up %d", 42));
+        REQUIRE_FALSE(made.interned());
+        REQUIRE(made.name() == "made up 42");
+
+        props[made] = 3;
+        REQUIRE(props.exists(string("made up 42")));
+        REQUIRE(props[string("made up 42")].get_int() == 3);
+        REQUIRE_FALSE(prop_key(string("made up 42")).interned());
+    }
+
+    SECTION ("lookups work from literals, strings and reused buffers") {
+        REQUIRE(props.exists("alpha"));
+        REQUIRE(props.exists(string("beta")));
+        REQUIRE(props["beta"].get_int() == 2);
+
+        char buf[16];
+        strcpy(buf, "alpha");
+        REQUIRE(props.exists(buf));
+        strcpy(buf, "gamma");
+        REQUIRE_FALSE(props.exists(buf));
+        strcpy(buf, "beta");
+        REQUIRE(props.exists(buf));
+        REQUIRE(props[buf].get_int() == 2);
+    }
+
+    SECTION ("erased and cleared keys are gone") {
+        props.erase("alpha");
+        REQUIRE_FALSE(props.exists("alpha"));
+        REQUIRE(props.find("alpha") == props.end());
+        REQUIRE(props.size() == 1);
+
+        props.clear();
+        REQUIRE_FALSE(props.exists("beta"));
+        REQUIRE(props.empty());
+    }
+
+    SECTION ("tables iterate in name order, whatever the insertion order") {
+        props["aardvark"] = 3;
+        props["zebra"] = 4;
+        vector<string> names;
+        for (const auto &entry : props)
+            names.push_back(entry.first);
+        const vector<string> expected = { "aardvark", "alpha", "beta", "zebra" };
+        REQUIRE(names == expected);
+    }
+
+    SECTION ("tables survive a save round trip") {
+        props["nested"].new_table()["inner"] = string("value");
+
+        vector<unsigned char> buf;
+        writer w(&buf);
+        props.write(w);
+
+        CrawlHashTable copy;
+        reader r(buf, TAG_MINOR_VERSION);
+        copy.read(r);
+        REQUIRE(copy.size() == 3);
+        REQUIRE(copy["alpha"].get_int() == 1);
+        REQUIRE(copy["nested"]["inner"].get_string() == "value");
+
+        // The names are saved in name order, as before keys were interned.
+        vector<unsigned char> again;
+        writer w2(&again);
+        copy.write(w2);
+        REQUIRE(again == buf);
+    }
+}
+
+// Many props lookups are in monster and item code that runs every turn, and
+// most of them are for keys that aren't set. This mimics a monster's props.
+TEST_CASE( "Benchmark props lookups", "[.benchmark]" ) {
+
+    const char *set_keys[] = {
+        "mon_speed_drained", "summon_id", "kraken_tentacle_num",
+        "dragon_charge", "mon_gender", "mslot_data",
+    };
+    const char *lookup_keys[] = {
+        "mon_speed_drained", "sap_magic_amount", "tempered_lightning_ench",
+        "iood_kc", "mon_gender", "polymorph_target", "blame",
+        "flayed_damage", "shadow_of_the_dead", "mirror_damage", "summon_id",
+        "tentacle_type", "kraken_tentacle_num", "ally_sacrifice",
+    };
+
+    CrawlHashTable props;
+    map<string, CrawlStoreValue> string_props;
+    for (const char *key : set_keys)
+    {
+        props[key] = 1;
+        string_props[key] = 1;
+    }
+
+    BENCHMARK("exists, interned keys")
+    {
+        int found = 0;
+        for (int i = 0; i < 100; ++i)
+            for (const char *key : lookup_keys)
+                found += props.exists(key);
+        return found;
+    };
+
+    BENCHMARK("exists, string keyed map")
+    {
+        int found = 0;
+        for (int i = 0; i < 100; ++i)
+            for (const char *key : lookup_keys)
+                found += string_props.find(key) != string_props.end();
+        return found;
+    };
+
+    BENCHMARK("get_value of set keys, interned keys")
+    {
+        int total = 0;
+        for (int i = 0; i < 100; ++i)
+            for (const char *key : set_keys)
+                total += props[key].get_int();
+        return total;
+    };
+}
@@ -5,6 +5,7 @@
 #include "AppHdr.h"
 
 #include "map-cell.h"
+#include "package.h"
 #include "random.h"
 #include "tags.h"
 
@@ -201,7 +202,7 @@ TEST_CASE( "Basic marshalling/unmarshalling works correctly.", "[single-file]" )
             short number = random_range(INT16_MIN, INT16_MAX);
 
             vector<unsigned char> buf;
-            auto w = writer(&buf);
+            writer w(&buf);
             marshallShort(w, number);
 
             auto r = reader(buf);
@@ -212,10 +213,91 @@ TEST_CASE( "Basic marshalling/unmarshalling works correctly.", "[single-file]" )
         }
     }
 
+    SECTION ("Integers are written in network byte order.") {
+        vector<unsigned char> buf;
+        writer w(&buf);
+        marshallShort(w, -2);
+        marshallInt(w, 0x01020304);
+        marshallInt(w, -2);
+        marshallUnsigned(w, 300);
+
+        const vector<unsigned char> expected = {
+            0xFF, 0xFE,
+            0x01, 0x02, 0x03, 0x04,
+            0xFF, 0xFF, 0xFF, 0xFE,
+            0xAC, 0x02,
+        };
+        REQUIRE(buf == expected);
+
+        auto r = reader(buf);
+        REQUIRE(unmarshallShort(r) == -2);
+        REQUIRE(unmarshallInt(r) == 0x01020304);
+        REQUIRE(unmarshallInt(r) == -2);
+        REQUIRE(unmarshallUnsigned(r) == 300);
+        REQUIRE(r.valid() == false);
+    }
+
+    SECTION ("Buffered chunk writes match unbuffered ones.") {
+        rng::subgenerator subgen(0, 0);
+
+        // Enough to overflow the chunk writer's buffer a few times.
+        vector<unsigned char> expected;
+        package pkg;
+        {
+            writer direct(&expected);
+            writer chunk(&pkg, "test");
+            for (auto i = 0; i < 100000; i++)
+            {
+                const int32_t number = rng::get_uint32();
+                marshallInt(direct, number);
+                marshallInt(chunk, number);
+                marshallByte(direct, i);
+                marshallByte(chunk, i);
+            }
+        }
+
+        reader r(&pkg, "test");
+        vector<unsigned char> actual(expected.size());
+        r.read(&actual[0], actual.size());
+        REQUIRE(actual == expected);
+        REQUIRE(r.valid() == false);
+    }
+
+    SECTION ("Readers can work on raw memory.") {
+        const unsigned char buf[] = { 0x00, 0x2A, 0x01, 0x02, 0x03, 0x04 };
+
+        reader r(buf + 2, sizeof(buf) - 2);
+        REQUIRE(unmarshallInt(r) == 0x01020304);
+        REQUIRE(r.valid() == false);
+
+        reader whole(buf, sizeof(buf));
+        whole.advance(2);
+        REQUIRE(unmarshallInt(whole) == 0x01020304);
+
+        reader empty(nullptr, 0);
+        empty.set_safe_read(true);
+        REQUIRE(empty.valid() == false);
+        REQUIRE_THROWS_AS(unmarshallByte(empty), short_read_exception);
+    }
+
+    SECTION ("Skipping past the end of a file is a short read.") {
+        FILE *fp = tmpfile();
+        REQUIRE(fp);
+        const unsigned char buf[] = { 0x01, 0x02, 0x03, 0x04 };
+        REQUIRE(fwrite(buf, 1, sizeof(buf), fp) == sizeof(buf));
+        rewind(fp);
+
+        reader r(fp);
+        r.set_safe_read(true);
+        r.advance(2);
+        REQUIRE_THROWS_AS(r.advance(8), short_read_exception);
+        fclose(fp);
+    }
+
     SECTION ("Map cells can be roundtripped.") {
         auto roundtrip_map_cell = [](const map_cell cell) {
             vector<unsigned char> buf;
-            auto w = writer(&buf);
+            writer w(&buf);
             marshallMapCell(w, cell);
 
             auto r = reader(buf);
@@ -245,3 +327,62 @@ TEST_CASE( "Basic marshalling/unmarshalling works correctly.", "[single-file]" )
         }
     }
 }
+
+// Run with "[.benchmark]". Marshalls a level's worth of map cells in the
+// layout _tag_construct_level() uses.
+TEST_CASE( "Benchmark marshalling map cells", "[.benchmark]" ) {
+
+    void marshallMapCell (writer &, const map_cell &);
+    void unmarshallMapCell (reader &, map_cell& cell);
+
+    rng::subgenerator subgen(0, 0);
+    vector<map_cell> cells(GXM * GYM);
+    // About a third of a typical level has been seen.
+    for (auto &cell : cells)
+        if (one_chance_in(3))
+            cell.flags = MAP_SEEN_FLAG;
+
+    auto marshall_cells = [&cells](writer &w)
+    {
+        for (const auto &cell : cells)
+        {
+            marshallByte(w, DNGN_FLOOR);
+            marshallMapCell(w, cell);
+            marshallInt(w, 0);
+        }
+    };
+
+    BENCHMARK("marshall to memory")
+    {
+        vector<unsigned char> buf;
+        writer w(&buf);
+        marshall_cells(w);
+        return buf.size();
+    };
+
+    BENCHMARK("marshall to a save chunk")
+    {
+        package pkg;
+        writer w(&pkg, "test");
+        marshall_cells(w);
+    };
+
+    vector<unsigned char> buf;
+    {
+        writer w(&buf);
+        marshall_cells(w);
+    }
+
+    BENCHMARK("unmarshall from memory")
+    {
+        auto r = reader(buf);
+        map_cell cell;
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            unmarshallByte(r);
+            unmarshallMapCell(r, cell);
+            unmarshallInt(r);
+        }
+        return cell.flags;
+    };
+}
@@ -0,0 +1,138 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "coordit.h"
+#include "env.h"
+#include "exclude.h"
+#include "mon-info.h"
+#include "options.h"
+#include "travel.h"
+#include "unwind.h"
+
+#include "test_player_fixture.h"
+
+// Two rooms joined by a short corridor with a door in it, and by a longer
+// loop below. Travel goes from the west room to the east one.
+static const coord_def travel_from(8, 10);
+static const coord_def travel_to(37, 10);
+static const coord_def corridor_door(22, 10);
+static const coord_def corridor_mid(25, 10);
+static const coord_def loop_mid(20, 20);
+
+static void _set_known_feat(const coord_def &p, dungeon_feature_type feat,
+                            trap_type trap = TRAP_UNASSIGNED)
+{
+    env.grid(p) = feat;
+    env.map_knowledge(p).set_feature(feat, 0, trap);
+    env.map_knowledge(p).flags |= MAP_SEEN_FLAG;
+}
+
+static void _carve(int x1, int y1, int x2, int y2)
+{
+    for (rectangle_iterator ri(coord_def(x1, y1), coord_def(x2, y2)); ri; ++ri)
+        _set_known_feat(*ri, DNGN_FLOOR);
+}
+
+static void _build_level()
+{
+    clear_excludes();
+    env.grid.init(DNGN_ROCK_WALL);
+    env.map_knowledge.init(map_cell());
+
+    _carve(5, 5, 15, 15);
+    _carve(30, 5, 40, 15);
+    _carve(16, 10, 29, 10);
+    _set_known_feat(corridor_door, DNGN_OPEN_DOOR);
+    _carve(10, 16, 10, 20);
+    _carve(10, 20, 35, 20);
+    _carve(35, 16, 35, 19);
+}
+
+struct travel_step
+{
+    coord_def move;
+    vector<int> dist;
+};
+
+static travel_step _travel_step(const coord_def &from, bool incremental)
+{
+    travel_pathfind tp;
+    tp.set_src_dst(from, travel_to);
+    if (incremental)
+        tp.set_incremental();
+
+    travel_step step;
+    step.move = tp.pathfind(RMODE_TRAVEL);
+    step.dist.assign(&travel_point_distance[0][0],
+                     &travel_point_distance[0][0] + GXM * GYM);
+    return step;
+}
+
+// The first step records a flood from travel_to; the step after it replays
+// that record if the map change left it usable.
+static void _check_replay(const coord_def &from)
+{
+    const travel_step replayed = _travel_step(from, true);
+    const travel_step fresh = _travel_step(from, false);
+
+    REQUIRE(fresh.move != coord_def());
+    REQUIRE(replayed.move == fresh.move);
+    REQUIRE(replayed.dist == fresh.dist);
+}
+
+TEST_CASE_METHOD(MockPlayerYouTestsFixture,
+                 "Travel flood replay matches a fresh flood", "[single-file]" ) {
+
+    _build_level();
+    const coord_def next = _travel_step(travel_from, true).move;
+    REQUIRE(next.x == travel_from.x + 1);
+
+    SECTION ("the map is unchanged") {
+        _check_replay(next);
+    }
+
+    SECTION ("a door on the path closes") {
+        _set_known_feat(corridor_door, DNGN_CLOSED_DOOR);
+        _check_replay(next);
+    }
+
+    SECTION ("a door on the path closes and travel avoids doors") {
+        unwind_var<travel_open_doors_type> doors(Options.travel_open_doors,
+                                                 travel_open_doors_type::avoid);
+        _set_known_feat(corridor_door, DNGN_CLOSED_DOOR);
+        _check_replay(next);
+    }
+
+    SECTION ("a trap appears on the path") {
+        _set_known_feat(corridor_mid, DNGN_TRAP_WEB, TRAP_WEB);
+        _check_replay(next);
+    }
+
+    SECTION ("the path is excluded") {
+        set_exclude(corridor_mid, 0);
+        _check_replay(next);
+        clear_excludes();
+    }
+
+    SECTION ("a stationary monster appears on the path") {
+        env.map_knowledge(corridor_mid).set_monster(monster_info(MONS_PLANT));
+        _check_replay(next);
+    }
+}
+
+TEST_CASE_METHOD(MockPlayerYouTestsFixture,
+                 "Travel flood replay follows a moved monster", "[single-file]" ) {
+
+    _build_level();
+    env.map_knowledge(corridor_mid).set_monster(monster_info(MONS_PLANT));
+
+    // The plant sends travel round the loop first...
+    const coord_def next = _travel_step(travel_from, true).move;
+    REQUIRE(next.y > travel_from.y);
+
+    // ...and then blocks the loop instead.
+    env.map_knowledge(corridor_mid).clear_monster();
+    env.map_knowledge(loop_mid).set_monster(monster_info(MONS_PLANT));
+    _check_replay(next);
+}
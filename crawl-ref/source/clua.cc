@@ -16,6 +16,8 @@
 #include "state.h"
 #include "stringutil.h"
 #include "syscalls.h"
+#include "tag-version.h"
+#include "tags.h"
 #include "unicode.h"
 #include "version.h"
 
@@ -37,6 +39,7 @@ static int  _clua_guarded_pcall(lua_State *);
 static int  _clua_require(lua_State *);
 static int  _clua_dofile(lua_State *);
 static int  _clua_loadfile(lua_State *);
+static void _init_hook_tracking(lua_State *);
 static string _get_persist_file();
 
 CLua::CLua(bool managed)
@@ -45,7 +48,7 @@ CLua::CLua(bool managed)
       throttle_sleep_ms(0), throttle_sleep_start(2),
       throttle_sleep_end(800), n_throttle_sleeps(0), mixed_call_depth(0),
       lua_call_depth(0), max_mixed_call_depth(8),
-      max_lua_call_depth(100), memory_used(0),
+      max_lua_call_depth(100), memory_used(0), global_epoch(0),
       _state(nullptr), sourced_files(), uniqindex(0)
 {
 }
@@ -267,6 +270,8 @@ int CLua::execstring(const char *s, const char *context, int nresults)
     lua_call_throttle strangler(this);
     err = lua_pcall(ls, 0, nresults, 0);
     set_error(err, ls);
+    // The code may have redefined any of the hooks.
+    ++global_epoch;
     return err;
 }
 
@@ -278,6 +283,93 @@ bool CLua::is_path_safe(string s, bool trusted)
            && (trusted || s.find("dlua") != 0);
 }
 
+// Compiled copies of the game's Lua files live in the des cache, each
+// tagged with the game version and the path and mtime of its source.
+static string _bytecode_cache_path(const char *filename)
+{
+    string name = filename;
+    replace(name.begin(), name.end(), '/', '_');
+    replace(name.begin(), name.end(), '\\', '_');
+    return catpath(savedir_versioned_path("des"), name + ".luac");
+}
+
+static int _bytecode_writer(lua_State *, const void *p, size_t sz, void *ud)
+{
+    static_cast<string *>(ud)->append(static_cast<const char *>(p), sz);
+    return 0;
+}
+
+// Pushes the cached chunk for file and returns true, if the cache has one
+// compiled from this version of it.
+static bool _load_cached_bytecode(lua_State *ls, const string &cache,
+                                  const string &file, time_t mtime)
+{
+    FILE *fp = fopen_u(cache.c_str(), "rb");
+    if (!fp)
+        return false;
+
+    string code;
+    try
+    {
+        reader inf(fp);
+        const auto version = get_save_version(inf);
+        if (version.major != TAG_MAJOR_VERSION
+            || version.minor != TAG_MINOR_VERSION
+            || unmarshallString(inf) != Version::Long
+            || unmarshallString(inf) != file
+            || unmarshallSigned(inf) != mtime)
+        {
+            fclose(fp);
+            return false;
+        }
+        unmarshallString4(inf, code);
+    }
+    catch (short_read_exception &E)
+    {
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+
+    if (luaL_loadbuffer(ls, code.data(), code.size(), ("@" + file).c_str()))
+    {
+        lua_pop(ls, 1);
+        return false;
+    }
+    return true;
+}
+
+// Caches the chunk on top of the stack, compiled from file.
+static void _write_cached_bytecode(lua_State *ls, const string &cache,
+                                   const string &file, time_t mtime)
+{
+    string code;
+    if (lua_dump(ls, _bytecode_writer, &code) || code.empty())
+        return;
+
+    string dir = savedir_versioned_path("des");
+    if (!check_mkdir("Data file cache", &dir, true))
+        return;
+
+    // Written aside and renamed into place, so that other processes see
+    // either the old chunk or the new one.
+    const string tmp = cache + ".tmp";
+    file_lock lock(catpath(dir, "luac.lk"), "wb", false);
+    FILE *fp = fopen_u(tmp.c_str(), "wb");
+    if (!fp)
+        return;
+    {
+        writer outf(tmp, fp);
+        write_save_version(outf, save_version::current());
+        marshallString(outf, Version::Long);
+        marshallString(outf, file);
+        marshallSigned(outf, mtime);
+        marshallString4(outf, code);
+    }
+    if (fclose(fp) || rename_u(tmp.c_str(), cache.c_str()))
+        unlink_u(tmp.c_str());
+}
+
 int CLua::loadfile(lua_State *ls, const char *filename, bool trusted,
                    bool die_on_fail)
 {
@@ -300,6 +392,15 @@ int CLua::loadfile(lua_State *ls, const char *filename, bool trusted,
         return -1;
     }
 
+    // Only the game's own scripts are cached; -reset-cache recompiles them.
+    const string cache = trusted ? _bytecode_cache_path(filename) : "";
+    const time_t mtime = file_modtime(file);
+    if (!cache.empty() && crawl_state.use_des_cache
+        && _load_cached_bytecode(ls, cache, file, mtime))
+    {
+        return 0;
+    }
+
     FileLineInput f(file.c_str());
     string script;
     while (!f.eof())
@@ -309,8 +410,11 @@ int CLua::loadfile(lua_State *ls, const char *filename, bool trusted,
         abort();
 
     // prefixing with @ stops lua from adding [string "%s"]
-    return luaL_loadbuffer(ls, &script[0], script.length(),
-                           ("@" + file).c_str());
+    const int err = luaL_loadbuffer(ls, &script[0], script.length(),
+                                    ("@" + file).c_str());
+    if (!err && !cache.empty())
+        _write_cached_bytecode(ls, cache, file, mtime);
+    return err;
 }
 
 int CLua::execfile(const char *filename, bool trusted, bool die_on_fail,
@@ -327,6 +431,7 @@ int CLua::execfile(const char *filename, bool trusted, bool die_on_fail,
     if (!err)
         sourced_files.insert(filename);
     set_error(err);
+    ++global_epoch;
     if (die_on_fail && !error.empty())
     {
         end(1, false, "Lua execfile error (%s): %s",
@@ -551,7 +656,9 @@ maybe_bool CLua::callmbooleanfn(const char *fn, const char *params,
 
     lua_stack_cleaner clean(ls);
 
-    pushglobal(fn);
+    // A null fn means the function is already on top of the stack.
+    if (fn)
+        pushglobal(fn);
     if (!lua_isfunction(ls, -1))
         return maybe_bool::maybe;
 
@@ -580,7 +687,9 @@ maybe_bool CLua::callmaybefn(const char *fn, const char *params, va_list args)
 
     lua_stack_cleaner clean(ls);
 
-    pushglobal(fn);
+    // A null fn means the function is already on top of the stack.
+    if (fn)
+        pushglobal(fn);
     if (!lua_isfunction(ls, -1))
         return maybe_bool::maybe;
 
@@ -655,23 +764,31 @@ void CLua::pushglobal(const string &name)
 }
 
 bool CLua::callfn(const char *fn, const char *params, ...)
+{
+    va_list args;
+    va_start(args, params);
+    const bool ret = vcallfn(fn, params, args);
+    va_end(args);
+    return ret;
+}
+
+bool CLua::vcallfn(const char *fn, const char *params, va_list args)
 {
     error.clear();
     lua_State *ls = state();
     if (!ls)
         return false;
 
-    pushglobal(fn);
+    // A null fn means the function is already on top of the stack.
+    if (fn)
+        pushglobal(fn);
     if (!lua_isfunction(ls, -1))
     {
         lua_pop(ls, 1);
         return false;
     }
 
-    va_list args;
     va_list fnret;
-    va_start(args, params);
-
     bool ret = calltopfn(ls, params, args, -1, &fnret);
     if (ret)
     {
@@ -679,7 +796,6 @@ bool CLua::callfn(const char *fn, const char *params, ...)
         if (proc_returns(params))
             vfnreturns(params, fnret);
     }
-    va_end(args);
     va_end(fnret);
     return ret;
 }
@@ -732,6 +848,8 @@ void CLua::init_lua()
     if (!_state)
         end(1, false, "Unable to create Lua state.");
 
+    ++global_epoch;
+
     lua_stack_cleaner clean(_state);
 
     lua_atpanic(_state, _clua_panic);
@@ -838,9 +956,48 @@ void CLua::init_libraries()
         lua_register(_state, "pcall", _clua_guarded_pcall);
         execfile("dlua/userbase.lua", true, true);
         execfile("dlua/persist.lua", true, true);
+        _init_hook_tracking(_state);
     }
 }
 
+static int _clua_new_global(lua_State *ls)
+{
+    lua_rawset(ls, 1);
+    ++CLua::get_vm(ls).global_epoch;
+    return 0;
+}
+
+// Hooks that userbase.lua defines to do nothing until they're redefined.
+static const char *noop_hooks[] =
+{
+    "c_message",
+};
+
+static void _init_hook_tracking(lua_State *ls)
+{
+    lua_stack_cleaner clean(ls);
+
+    lua_newtable(ls);
+    for (const char *hook : noop_hooks)
+    {
+        lua_getglobal(ls, hook);
+        if (!lua_isfunction(ls, -1))
+        {
+            lua_pop(ls, 1);
+            continue;
+        }
+        lua_pushboolean(ls, true);
+        lua_rawset(ls, -3);
+    }
+    lua_setfield(ls, LUA_REGISTRYINDEX, "__noop_hooks");
+
+    // Let lua_hook know when a global is first defined.
+    lua_newtable(ls);
+    lua_pushcfunction(ls, _clua_new_global);
+    lua_setfield(ls, -2, "__newindex");
+    lua_setmetatable(ls, LUA_GLOBALSINDEX);
+}
+
 CLua &CLua::get_vm(lua_State *ls)
 {
     lua_stack_cleaner clean(ls);
@@ -1169,6 +1326,127 @@ lua_call_throttle::~lua_call_throttle()
         lua_map.erase(lua->state());
 }
 
+//////////////////////////////////////////////////////////////////////////
+// lua_hook
+
+lua_hook::lua_hook(const char *_name)
+    : name(_name), fn(), noop(false), checked_epoch(0)
+{
+}
+
+// Has the global been set to something else since it was looked up?
+// Replacing an existing global doesn't go through __newindex, so it doesn't
+// change the epoch.
+bool lua_hook::replaced(lua_State *ls) const
+{
+    lua_pushstring(ls, name);
+    lua_rawget(ls, LUA_GLOBALSINDEX);
+    fn->push();
+    const bool same = lua_rawequal(ls, -1, -2);
+    lua_pop(ls, 2);
+    return !same;
+}
+
+void lua_hook::look_up(CLua &lua)
+{
+    lua_State *ls = lua.state();
+    checked_epoch = lua.global_epoch;
+    fn.reset();
+    noop = false;
+
+    lua_stack_cleaner clean(ls);
+    lua_getglobal(ls, name);
+    const int found = lua_gettop(ls);
+    if (!lua_isfunction(ls, found))
+        return;
+
+    fn.reset(new lua_datum(lua, found, false));
+
+    // The do-nothing defaults from userbase.lua count as undefined.
+    lua_getfield(ls, LUA_REGISTRYINDEX, "__noop_hooks");
+    if (lua_istable(ls, -1))
+    {
+        lua_pushvalue(ls, found);
+        lua_rawget(ls, -2);
+        noop = lua_toboolean(ls, -1);
+    }
+}
+
+bool lua_hook::active(CLua &lua)
+{
+    lua_State *ls = lua.state();
+    if (!ls)
+        return false;
+
+    // init_lua() starts the epoch past 0, so this always looks the first
+    // time round.
+    if (checked_epoch != lua.global_epoch || fn && replaced(ls))
+        look_up(lua);
+
+    if (fn && !noop)
+        return true;
+
+    lua.error.clear();
+    return false;
+}
+
+bool lua_hook::callfn(CLua &lua, int nargs, int nret)
+{
+    ASSERT(fn);
+    fn->push();
+    // Slide the function in front of its args.
+    if (nargs)
+        lua_insert(lua, -nargs - 1);
+    return lua.callfn(nullptr, nargs, nret);
+}
+
+bool lua_hook::callfn(CLua &lua, const char *params, ...)
+{
+    ASSERT(fn);
+    fn->push();
+    va_list args;
+    va_start(args, params);
+    const bool ret = lua.vcallfn(nullptr, params, args);
+    va_end(args);
+    return ret;
+}
+
+maybe_bool lua_hook::callmbooleanfn(CLua &lua, const char *params, ...)
+{
+    ASSERT(fn);
+    lua_stack_cleaner clean(lua);
+    fn->push();
+    va_list args;
+    va_start(args, params);
+    const maybe_bool ret = lua.callmbooleanfn(nullptr, params, args);
+    va_end(args);
+    return ret;
+}
+
+maybe_bool lua_hook::callmaybefn(CLua &lua, const char *params, ...)
+{
+    ASSERT(fn);
+    lua_stack_cleaner clean(lua);
+    fn->push();
+    va_list args;
+    va_start(args, params);
+    const maybe_bool ret = lua.callmaybefn(nullptr, params, args);
+    va_end(args);
+    return ret;
+}
+
+bool lua_hook::callbooleanfn(CLua &lua, bool defval, const char *params, ...)
+{
+    ASSERT(fn);
+    lua_stack_cleaner clean(lua);
+    fn->push();
+    va_list args;
+    va_start(args, params);
+    const maybe_bool ret = lua.callmbooleanfn(nullptr, params, args);
+    va_end(args);
+    return ret.to_bool(defval);
+}
+
 CLua *lua_call_throttle::find_clua(lua_State *ls)
 {
     return lookup(lua_map, ls, nullptr);
@@ -168,6 +168,10 @@ public:
 
     long memory_used;
 
+    // Bumped whenever Lua defines a new global or runs a chunk of code
+    // (execstring(), execfile(), dlua_chunk::run()), for lua_hook.
+    unsigned int global_epoch;
+
     static const int MAX_THROTTLE_SLEEPS = 15;
 
 private:
@@ -191,6 +195,7 @@ private:
 
     bool calltopfn(lua_State *ls, const char *format, va_list args,
                    int retc = -1, va_list *fnr = nullptr);
+    bool vcallfn(const char *fn, const char *params, va_list args);
     maybe_bool callmbooleanfn(const char *fn, const char *params,
                               va_list args);
     maybe_bool callmaybefn(const char *fn, const char *params,
@@ -209,6 +214,41 @@ private:
     };
 
     friend class lua_call_throttle;
+    friend class lua_hook;
+};
+
+// A game-to-Lua hook, such as c_message, called often enough that looking
+// it up each time matters. The function is looked up again only when Lua
+// defines a new global or runs a chunk of code, as loading an rc file does
+// (see CLua::global_epoch), or when the global no longer holds the function
+// found last time. An undefined hook costs one integer compare; a defined
+// one, or the do-nothing default from userbase.lua, adds a raw lookup of the
+// global to spot it being replaced, say from inside ready().
+//
+// Call sites check active() and only then call through the hook, which
+// does what the CLua function of the same name would.
+class lua_hook
+{
+public:
+    explicit lua_hook(const char *name);
+
+    bool active(CLua &lua);
+
+    bool callfn(CLua &lua, int nargs, int nret = 1);
+    bool callfn(CLua &lua, const char *params, ...);
+    maybe_bool callmbooleanfn(CLua &lua, const char *params, ...);
+    maybe_bool callmaybefn(CLua &lua, const char *params, ...);
+    bool callbooleanfn(CLua &lua, bool defval, const char *params, ...);
+
+private:
+    const char *name;
+    // the global when last looked up, if it was a function
+    unique_ptr<lua_datum> fn;
+    bool noop;
+    unsigned int checked_epoch;
+
+    bool replaced(lua_State *ls) const;
+    void look_up(CLua &lua);
 };
 
 class lua_text_pattern : public base_pattern
@@ -206,6 +206,7 @@ void run_tests()
         _run_test("xom-data", validate_xom_events);
         _run_test("maybe-bool", maybe_bool::test_cases);
         _run_test("fixedp", fixedp<>::test_cases);
+        _run_test("pregen", pregen_tests);
     }
 #else
     ASSERT(crawl_state.script);
@@ -7,6 +7,12 @@
 
 #include "dbg-maps.h"
 
+#ifdef UNIX
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "branch.h"
 #include "chardump.h"
 #include "crash.h"
@@ -19,12 +25,15 @@
 #include "maps.h"
 #include "message.h"
 #include "ng-init.h"
+#include "ng-setup.h" // initial_dungeon_setup
+#include "options.h"
 #include "player.h"
 #include "shopping.h"
 #include "state.h"
 #include "stringutil.h"
 #include "syscalls.h"
 #include "tag-version.h"
+#include "unicode.h"
 #include "view.h"
 
 #ifdef DEBUG_STATISTICS
@@ -220,26 +229,11 @@ static bool _build_dungeon()
     return true;
 }
 
-/**
- * Build dungeon levels for mapstat or objstat.
- *
- * The exact branches/levels built and number of build iterations is set by the
- * command-line options for mapstat/objstat.
-
- * @returns True if all iterations built successfully. For mapstat, this can
- * return false if an iteration produced a disconnected level, since for
- * diagnostic purposes we record the map in detail to a file and exit. For
- * objstat, this only returns false if the primary dungeon generation function
- * builder() fails, as the level may be in an invalid state and any object
- * statistics erroneous.
-*/
-bool mapstat_build_levels()
+// Each iteration is a new game from its own seed, so a job building a slice
+// of them builds just what a single process would.
+static bool _build_iterations(int first, int last, uint64_t base_seed)
 {
-    if (!generated_levels.size())
-        _dungeon_places();
-    printf("Iteration: ");
-    fflush(stdout);
-    for (int i = 0; i < SysEnv.map_gen_iters; ++i)
+    for (int i = first; i < last; ++i)
     {
         clear_messages();
         mprf("On %d of %d; %d g, %d fail, %u err%s, %u uniq, "
@@ -251,21 +245,316 @@ bool mapstat_build_levels()
              build_attempts ? level_vetoes * 100.0 / build_attempts : 0.0);
         printf("%d..", i + 1);
         fflush(stdout);
-        dlua.callfn("dgn_clear_data", "");
-        you.uniq_map_tags.clear();
-        you.uniq_map_names.clear();
-        you.uniq_map_tags_abyss.clear();
-        you.uniq_map_names_abyss.clear();
-        you.unique_creatures.reset();
+        rng::seed(base_seed + i);
+        dgn_flush_map_memory();
         you.generated_misc.clear();
         initialise_item_sets(true);
-        initialise_branch_depths();
-        init_level_connectivity();
+        initial_dungeon_setup();
         if (!_build_dungeon())
             return false;
         if (crawl_state.obj_stat_gen)
             objstat_iteration_stats();
     }
+    return true;
+}
+
+#ifdef UNIX
+// Sharded runs: each job builds its own slice of the iterations and leaves
+// its tallies in a file of tab-separated records, which the parent adds
+// back into its own tables before writing the usual reports.
+
+static string _shard_file(const string &dir, int job)
+{
+    return make_stringf("%s/shard_%d.tmp", dir.c_str(), job);
+}
+
+// A private directory for the shards, so that they don't land among the
+// reports or collide with another run's.
+static string _make_shard_dir()
+{
+    const char *tmp = getenv("TMPDIR");
+    string dir = string(tmp && *tmp ? tmp : "/tmp") + "/crawl-mapstat.XXXXXX";
+    if (!mkdtemp(&dir[0]))
+    {
+        fprintf(stderr, "Couldn't make a directory for the jobs: %s\n",
+                strerror(errno));
+        return "";
+    }
+    return dir;
+}
+
+// Map names and level ids are safe as they are, but veto and error messages
+// are free text.
+static string _shard_escape(const string &s)
+{
+    string out;
+    for (char c : s)
+    {
+        if (c == '\\')
+            out += "\\\\";
+        else if (c == '\t')
+            out += "\\t";
+        else if (c == '\n')
+            out += "\\n";
+        else
+            out += c;
+    }
+    return out;
+}
+
+static string _shard_unescape(const string &s)
+{
+    string out;
+    for (size_t i = 0; i < s.length(); ++i)
+    {
+        if (s[i] != '\\' || i + 1 == s.length())
+        {
+            out += s[i];
+            continue;
+        }
+
+        const char c = s[++i];
+        out += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+    }
+    return out;
+}
+
+static void _write_shard(FILE *outf)
+{
+    fprintf(outf, "levels\t%d\t%d\t%d\t%d\n", levels_tried, levels_failed,
+            build_attempts, level_vetoes);
+
+    for (const auto &entry : try_count)
+        fprintf(outf, "try\t%s\t%d\n", entry.first.c_str(), entry.second);
+    for (const auto &entry : use_count)
+        fprintf(outf, "use\t%s\t%d\n", entry.first.c_str(), entry.second);
+    for (const auto &entry : success_count)
+    {
+        fprintf(outf, "success\t%s\t%d\n", entry.first.c_str(),
+                entry.second);
+    }
+
+    for (const auto &entry : level_mapcounts)
+    {
+        fprintf(outf, "mapcount\t%d\t%d\t%d\n", entry.first.branch,
+                entry.first.depth, entry.second);
+    }
+    for (const auto &entry : map_builds)
+    {
+        fprintf(outf, "builds\t%d\t%d\t%d\t%d\n", entry.first.branch,
+                entry.first.depth, entry.second.first, entry.second.second);
+    }
+
+    // map_levelsused is the same relation the other way round.
+    for (const auto &entry : level_mapsused)
+        for (const string &name : entry.second)
+        {
+            fprintf(outf, "mapused\t%d\t%d\t%s\n", entry.first.branch,
+                    entry.first.depth, name.c_str());
+        }
+
+    for (const auto &entry : errors)
+    {
+        fprintf(outf, "error\t%s\t%s\n", entry.first.c_str(),
+                _shard_escape(entry.second).c_str());
+    }
+    for (const auto &entry : veto_messages)
+    {
+        fprintf(outf, "veto\t%d\t%s\n", entry.second,
+                _shard_escape(entry.first).c_str());
+    }
+
+    if (crawl_state.obj_stat_gen)
+        objstat_write_shard(outf);
+}
+
+static bool _merge_shard_record(const vector<string> &rec)
+{
+    const string &kind = rec[0];
+    if (kind == "levels" && rec.size() == 5)
+    {
+        levels_tried   += atoi(rec[1].c_str());
+        levels_failed  += atoi(rec[2].c_str());
+        build_attempts += atoi(rec[3].c_str());
+        level_vetoes   += atoi(rec[4].c_str());
+    }
+    else if (kind == "try" && rec.size() == 3)
+        try_count[rec[1]] += atoi(rec[2].c_str());
+    else if (kind == "use" && rec.size() == 3)
+        use_count[rec[1]] += atoi(rec[2].c_str());
+    else if (kind == "success" && rec.size() == 3)
+        success_count[rec[1]] += atoi(rec[2].c_str());
+    else if (kind == "mapcount" && rec.size() == 4)
+    {
+        const level_id lid((branch_type) atoi(rec[1].c_str()),
+                           atoi(rec[2].c_str()));
+        level_mapcounts[lid] += atoi(rec[3].c_str());
+    }
+    else if (kind == "builds" && rec.size() == 5)
+    {
+        const level_id lid((branch_type) atoi(rec[1].c_str()),
+                           atoi(rec[2].c_str()));
+        map_builds[lid].first  += atoi(rec[3].c_str());
+        map_builds[lid].second += atoi(rec[4].c_str());
+    }
+    else if (kind == "mapused" && rec.size() == 4)
+    {
+        const level_id lid((branch_type) atoi(rec[1].c_str()),
+                           atoi(rec[2].c_str()));
+        level_mapsused[lid].insert(rec[3]);
+        map_levelsused[rec[3]].insert(lid);
+    }
+    else if (kind == "error" && rec.size() == 3)
+        errors[rec[1]] = _shard_unescape(rec[2]);
+    else if (kind == "veto" && rec.size() == 3)
+        veto_messages[_shard_unescape(rec[2])] += atoi(rec[1].c_str());
+    else if (kind == "obj")
+        return crawl_state.obj_stat_gen && objstat_merge_shard_record(rec);
+    else
+        return false;
+
+    return true;
+}
+
+static bool _merge_shard(const string &file)
+{
+    UTF8FileLineInput inf(file.c_str());
+    if (inf.error())
+    {
+        fprintf(stderr, "Couldn't read %s.\n", file.c_str());
+        return false;
+    }
+
+    while (!inf.eof())
+    {
+        const string line = inf.get_line();
+        if (line.empty())
+            continue;
+
+        const vector<string> rec = split_string("\t", line, false, true, -1,
+                                                true);
+        if (!_merge_shard_record(rec))
+        {
+            fprintf(stderr, "Bad record in %s: %s\n", file.c_str(),
+                    line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static NORETURN void _run_shard(const string &dir, int job, int jobs,
+                                uint64_t base_seed)
+{
+    const int first = SysEnv.map_gen_iters * job / jobs;
+    const int last = SysEnv.map_gen_iters * (job + 1) / jobs;
+    const bool built = _build_iterations(first, last, base_seed);
+
+    // Write what we have even after a failure, just as a single process
+    // would go on to report it.
+    const string file = _shard_file(dir, job);
+    FILE *outf = fopen_u(file.c_str(), "w");
+    if (!outf)
+    {
+        fprintf(stderr, "Couldn't write %s: %s\n", file.c_str(),
+                strerror(errno));
+        _exit(1);
+    }
+    _write_shard(outf);
+    const bool written = !ferror(outf);
+    fclose(outf);
+
+    fflush(stdout);
+    fflush(stderr);
+    // Skip the atexit handlers; the parent still owns the game state.
+    _exit(built && written ? 0 : 1);
+}
+
+static bool _build_levels_sharded(uint64_t base_seed)
+{
+    const string dir = _make_shard_dir();
+    if (dir.empty())
+        return false;
+
+    const int jobs = min(SysEnv.map_gen_jobs, SysEnv.map_gen_iters);
+    printf("Running %d jobs.\nIteration: ", jobs);
+    fflush(stdout);
+    fflush(stderr);
+
+    vector<pid_t> workers;
+    for (int job = 0; job < jobs; ++job)
+    {
+        const pid_t pid = fork();
+        if (pid == -1)
+        {
+            fprintf(stderr, "Couldn't fork: %s\n", strerror(errno));
+            break;
+        }
+        if (!pid)
+            _run_shard(dir, job, jobs, base_seed);
+        workers.push_back(pid);
+    }
+
+    bool ok = (int) workers.size() == jobs;
+    for (int job = 0, size = workers.size(); job < size; ++job)
+    {
+        int status;
+        if (waitpid(workers[job], &status, 0) == -1
+            || !WIFEXITED(status) || WEXITSTATUS(status))
+        {
+            fprintf(stderr, "Job %d failed.\n", job);
+            ok = false;
+        }
+    }
+
+    // The merge only sums, unions and takes minima and maxima, so the order
+    // doesn't matter; do it in job order anyway.
+    for (int job = 0, size = workers.size(); job < size; ++job)
+    {
+        const string file = _shard_file(dir, job);
+        if (!_merge_shard(file))
+            ok = false;
+        unlink_u(file.c_str());
+    }
+    rmdir(dir.c_str());
+
+    if (ok)
+        printf("Finished.\n");
+    fflush(stdout);
+    return ok;
+}
+#endif
+
+/**
+ * Build dungeon levels for mapstat or objstat.
+ *
+ * The exact branches/levels built and number of build iterations is set by the
+ * command-line options for mapstat/objstat. With more than one job, the
+ * iterations are split over forked worker processes and their statistics
+ * merged back in here.
+
+ * @returns True if all iterations built successfully. For mapstat, this can
+ * return false if an iteration produced a disconnected level, since for
+ * diagnostic purposes we record the map in detail to a file and exit. For
+ * objstat, this only returns false if the primary dungeon generation function
+ * builder() fails, as the level may be in an invalid state and any object
+ * statistics erroneous.
+*/
+bool mapstat_build_levels()
+{
+    if (!generated_levels.size())
+        _dungeon_places();
+
+    const uint64_t base_seed = Options.seed ? Options.seed : rng::get_uint64();
+    printf("Base seed %" PRIu64 " (use -seed to repeat).\n", base_seed);
+#ifdef UNIX
+    if (SysEnv.map_gen_jobs > 1 && SysEnv.map_gen_iters > 1)
+        return _build_levels_sharded(base_seed);
+#endif
+    printf("Iteration: ");
+    fflush(stdout);
+    if (!_build_iterations(0, SysEnv.map_gen_iters, base_seed))
+        return false;
     printf("Finished.\n");
     fflush(stdout);
     return true;
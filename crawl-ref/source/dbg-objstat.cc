@@ -1023,6 +1023,145 @@ void objstat_iteration_stats()
     }
 }
 
+// Records for sharded runs, one per field: "obj", the table, the level's
+// branch and depth, the table's keys, then the field and its value.
+static void _write_shard_stats(FILE *outf, const char *table,
+                               const level_id &lev, const string &keys,
+                               const map<string, int> &stats)
+{
+    for (const auto &entry : stats)
+    {
+        // The per-iteration scratch fields are always zero between
+        // iterations; leave them, and the other empty sums, out. A minimum
+        // or maximum of zero still counts.
+        if (!entry.second && entry.first != "NumMin"
+            && entry.first != "NumMax")
+        {
+            continue;
+        }
+
+        fprintf(outf, "obj\t%s\t%d\t%d\t%s\t%s\t%d\n", table, lev.branch,
+                lev.depth, keys.c_str(), entry.first.c_str(), entry.second);
+    }
+}
+
+void objstat_write_shard(FILE *outf)
+{
+    for (const auto &lev : item_recs)
+        for (const auto &base : lev.second)
+            for (const auto &sub : base.second)
+            {
+                _write_shard_stats(outf, "item", lev.first,
+                                   make_stringf("%d\t%d", base.first,
+                                                sub.first),
+                                   sub.second);
+            }
+
+    for (const auto &lev : brand_recs)
+        for (const auto &base : lev.second)
+            for (const auto &sub : base.second)
+                for (const auto &cat : sub.second)
+                    for (const auto &brand : cat.second)
+                    {
+                        if (!brand.second)
+                            continue;
+                        fprintf(outf, "obj\tbrand\t%d\t%d\t%d\t%d\t%d"
+                                "\t%d\t%d\n", lev.first.branch,
+                                lev.first.depth, base.first, sub.first,
+                                cat.first, brand.first, brand.second);
+                    }
+
+    for (const auto &lev : monster_recs)
+        for (const auto &mons : lev.second)
+        {
+            _write_shard_stats(outf, "monster", lev.first,
+                               make_stringf("%d", mons.first), mons.second);
+        }
+
+    for (const auto &lev : feature_recs)
+        for (const auto &feat : lev.second)
+        {
+            _write_shard_stats(outf, "feature", lev.first,
+                               make_stringf("%d", feat.first), feat.second);
+        }
+
+    for (const auto &lev : spell_recs)
+        for (const auto &spell : lev.second)
+        {
+            _write_shard_stats(outf, "spell", lev.first,
+                               make_stringf("%d", spell.first), spell.second);
+        }
+}
+
+// Every job starts from the same _init_stats() tables as this process, so
+// minima and maxima merge as such and everything else adds up.
+static void _merge_shard_stat(map<string, int> &stats, const string &field,
+                              int value)
+{
+    if (field == "NumMin")
+    {
+        auto it = stats.find(field);
+        stats[field] = it == stats.end() ? value : min(it->second, value);
+    }
+    else if (field == "NumMax")
+    {
+        auto it = stats.find(field);
+        stats[field] = it == stats.end() ? value : max(it->second, value);
+    }
+    else
+        stats[field] += value;
+}
+
+bool objstat_merge_shard_record(const vector<string> &rec)
+{
+    if (rec.size() < 7)
+        return false;
+
+    vector<int> nums;
+    for (size_t i = 2; i < rec.size(); ++i)
+        nums.push_back(atoi(rec[i].c_str()));
+
+    const string &table = rec[1];
+    const level_id lev(static_cast<branch_type>(nums[0]), nums[1]);
+    if (table == "brand" && rec.size() == 9)
+    {
+        brand_recs[lev][static_cast<item_base_type>(nums[2])][nums[3]]
+                  [static_cast<stat_category_type>(nums[4])][nums[5]]
+            += nums[6];
+        return true;
+    }
+
+    // The remaining tables end with a field name and its value.
+    const string &field = rec[rec.size() - 2];
+    const int value = nums.back();
+    if (table == "item" && rec.size() == 8)
+    {
+        _merge_shard_stat(item_recs[lev][static_cast<item_base_type>(nums[2])]
+                                   [nums[3]],
+                          field, value);
+    }
+    else if (table == "monster" && rec.size() == 7)
+    {
+        _merge_shard_stat(monster_recs[lev][static_cast<monster_type>(nums[2])],
+                          field, value);
+    }
+    else if (table == "feature" && rec.size() == 7)
+    {
+        _merge_shard_stat(
+            feature_recs[lev][static_cast<dungeon_feature_type>(nums[2])],
+            field, value);
+    }
+    else if (table == "spell" && rec.size() == 7)
+    {
+        _merge_shard_stat(spell_recs[lev][static_cast<spell_type>(nums[2])],
+                          field, value);
+    }
+    else
+        return false;
+
+    return true;
+}
+
 static FILE * _open_stat_file(string stat_file)
 {
     FILE *stat_fh = nullptr;
@@ -336,6 +336,13 @@ void debug_mons_scan()
                               m->type, pos.x, pos.y, i);
         }
 
+        if (!env.mons_used.contains(i))
+        {
+            mprf(MSGCH_ERROR, "Monster %s at (%d, %d) is in an unused slot, "
+                              "midx = %d",
+                 m->full_name(DESC_PLAIN).c_str(), pos.x, pos.y, i);
+        }
+
         if (!in_bounds(pos))
         {
             mprf(MSGCH_ERROR, "Out of bounds monster: %s at (%d, %d), "
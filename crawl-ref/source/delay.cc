@@ -1050,8 +1050,10 @@ static maybe_bool _userdef_interrupt_activity(Delay* delay,
 
     const char *interrupt_name = _activity_interrupt_name(ai);
 
-    bool ran = clua.callfn("c_interrupt_activity", "1:ssA",
-                           delay->name(), interrupt_name, &at);
+    static lua_hook c_interrupt_activity("c_interrupt_activity");
+    bool ran = c_interrupt_activity.active(clua)
+               && c_interrupt_activity.callfn(clua, "1:ssA", delay->name(),
+                                              interrupt_name, &at);
     if (ran)
     {
         // If the function returned nil, we want to cease processing.
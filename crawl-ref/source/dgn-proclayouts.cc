@@ -15,6 +15,47 @@
 #include "tag-version.h"
 #include "terrain.h"
 
+void ProceduralLayout::sample_all(const vector<coord_def> &ps,
+    const uint32_t offset, vector<ProceduralSample> &out) const
+{
+    out.clear();
+    out.reserve(ps.size());
+    for (const coord_def &p : ps)
+        out.push_back((*this)(p, offset));
+}
+
+// Samples the points ps of a batch with layout, all at once, and stores
+// their features at index in feats. Each changepoint is the earlier of the
+// sample's and the one already in changepoints.
+static void _sample_into(const ProceduralLayout &layout,
+                         const vector<coord_def> &ps, const vector<int> &index,
+                         const uint32_t offset,
+                         vector<dungeon_feature_type> &feats,
+                         vector<uint32_t> &changepoints)
+{
+    if (ps.empty())
+        return;
+    vector<ProceduralSample> samples;
+    layout.sample_all(ps, offset, samples);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        feats[index[i]] = samples[i].feat();
+        changepoints[index[i]] = min(changepoints[index[i]],
+                                     samples[i].changepoint());
+    }
+}
+
+static void _fill_samples(const vector<coord_def> &ps,
+                          const vector<dungeon_feature_type> &feats,
+                          const vector<uint32_t> &changepoints,
+                          vector<ProceduralSample> &out)
+{
+    out.clear();
+    out.reserve(ps.size());
+    for (size_t i = 0; i < ps.size(); ++i)
+        out.emplace_back(ps[i], feats[i], changepoints[i]);
+}
+
 static dungeon_feature_type _pick_pseudorandom_wall(uint64_t val)
 {
     static dungeon_feature_type features[] =
@@ -66,29 +107,67 @@ static uint32_t _get_changepoint(const worley::noise_datum &n, const double scal
     return max(1, (int) floor((n.distance[1] - n.distance[0]) * scale) - 5);
 }
 
-ProceduralSample
-WorleyLayout::operator()(const coord_def &p, const uint32_t offset) const
-{
-    const double offset_scale = 5000.0;
-    double x = p.x / scale;
-    double y = p.y / scale;
-    double z = offset / offset_scale;
-    worley::noise_datum n = worley::noise(x, y, z + seed);
+static const double WORLEY_OFFSET_SCALE = 5000.0;
 
-    const uint32_t changepoint = offset + _get_changepoint(n, offset_scale);
+// Which of the layouts p falls in, and where in it.
+int WorleyLayout::_choose(const coord_def &p, const worley::noise_datum &n,
+                          coord_def &pd) const
+{
     const uint8_t size = layouts.size();
     bool parity = n.id[0] % 4;
     uint32_t id = n.id[0] / 4;
     const uint8_t choice = parity
         ? id % size
         : min(id % size, (id / size) % size);
-    const coord_def pd = p + id;
-    ProceduralSample sample = (*layouts[(choice + seed) % size])(pd, offset);
+    pd = p + id;
+    return (choice + seed) % size;
+}
+
+ProceduralSample
+WorleyLayout::operator()(const coord_def &p, const uint32_t offset) const
+{
+    double x = p.x / scale;
+    double y = p.y / scale;
+    double z = offset / WORLEY_OFFSET_SCALE;
+    worley::noise_datum n = worley::noise(x, y, z + seed);
+
+    const uint32_t changepoint = offset
+                                 + _get_changepoint(n, WORLEY_OFFSET_SCALE);
+    coord_def pd;
+    const int which = _choose(p, n, pd);
+    ProceduralSample sample = (*layouts[which])(pd, offset);
 
     return ProceduralSample(p, sample.feat(),
                 min(changepoint, sample.changepoint()));
 }
 
+void WorleyLayout::sample_all(const vector<coord_def> &ps,
+    const uint32_t offset, vector<ProceduralSample> &out) const
+{
+    const int count = ps.size();
+    const double z = offset / WORLEY_OFFSET_SCALE;
+    vector<dungeon_feature_type> feats(count);
+    vector<uint32_t> changepoints(count);
+    vector<vector<coord_def>> sub_ps(layouts.size());
+    vector<vector<int>> sub_index(layouts.size());
+    for (int i = 0; i < count; ++i)
+    {
+        worley::noise_datum n = worley::noise(ps[i].x / scale,
+                                              ps[i].y / scale, z + seed);
+        changepoints[i] = offset + _get_changepoint(n, WORLEY_OFFSET_SCALE);
+        coord_def pd;
+        const int which = _choose(ps[i], n, pd);
+        sub_ps[which].push_back(pd);
+        sub_index[which].push_back(i);
+    }
+    for (size_t i = 0; i < layouts.size(); ++i)
+    {
+        _sample_into(*layouts[i], sub_ps[i], sub_index[i], offset, feats,
+                     changepoints);
+    }
+    _fill_samples(ps, feats, changepoints, out);
+}
+
 ProceduralSample
 ChaosLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
@@ -126,20 +205,21 @@ WastesLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, feat, min(sample.changepoint(), changepoint));
 }
 
-ProceduralSample
-RiverLayout::operator()(const coord_def &p, const uint32_t offset) const
+static const double RIVER_SCALE = 10000;
+static const double RIVER_SCALAR = 90.0;
+
+// The river at p, or DNGN_UNSEEN if it's left to the layout underneath.
+dungeon_feature_type RiverLayout::_river(const coord_def &p,
+                                         const uint32_t offset,
+                                         const worley::noise_datum &n,
+                                         uint32_t &changepoint) const
 {
-    const double scale = 10000;
-    const double scalar = 90.0;
-    double x = (p.x + perlin::fBM(p.x/4.0, p.y/4.0, seed, 5) * 3) / scalar;
-    double y = (p.y + perlin::fBM(p.x/4.0 + 3.7, p.y/4.0 + 1.9, seed + 4, 5) * 3) / scalar;
-    worley::noise_datum n = worley::noise(x, y, offset / scale + seed);
-    const uint32_t changepoint = offset + _get_changepoint(n, scale);
+    changepoint = offset + _get_changepoint(n, RIVER_SCALE);
     if ((n.id[0] ^ n.id[1] ^ seed) % 4)
-        return layout(p, offset);
+        return DNGN_UNSEEN;
 
     double delta = n.distance[1] - n.distance[0];
-    if (delta < 1.5/scalar)
+    if (delta < 1.5/RIVER_SCALAR)
     {
         dungeon_feature_type feat = DNGN_SHALLOW_WATER;
         uint64_t hash = hash3(p.x, p.y, n.id[0] + seed);
@@ -147,9 +227,62 @@ RiverLayout::operator()(const coord_def &p, const uint32_t offset) const
             feat = DNGN_DEEP_WATER;
         if (!(hash % 23))
             feat = DNGN_TREE;
-        return ProceduralSample(p, feat, changepoint);
+        return feat;
     }
-    return layout(p, offset);
+    return DNGN_UNSEEN;
+}
+
+ProceduralSample
+RiverLayout::operator()(const coord_def &p, const uint32_t offset) const
+{
+    double x = (p.x + perlin::fBM(p.x/4.0, p.y/4.0, seed, 5) * 3) / RIVER_SCALAR;
+    double y = (p.y + perlin::fBM(p.x/4.0 + 3.7, p.y/4.0 + 1.9, seed + 4, 5) * 3) / RIVER_SCALAR;
+    worley::noise_datum n = worley::noise(x, y, offset / RIVER_SCALE + seed);
+    uint32_t changepoint;
+    const dungeon_feature_type feat = _river(p, offset, n, changepoint);
+    if (feat == DNGN_UNSEEN)
+        return layout(p, offset);
+    return ProceduralSample(p, feat, changepoint);
+}
+
+void RiverLayout::sample_all(const vector<coord_def> &ps,
+    const uint32_t offset, vector<ProceduralSample> &out) const
+{
+    const int count = ps.size();
+    vector<double> fx(count), fy(count), dx(count), dy(count);
+    for (int i = 0; i < count; ++i)
+    {
+        fx[i] = ps[i].x/4.0;
+        fy[i] = ps[i].y/4.0;
+    }
+    perlin::fBM(fx.data(), fy.data(), seed, 5, count, dx.data());
+    for (int i = 0; i < count; ++i)
+    {
+        fx[i] = ps[i].x/4.0 + 3.7;
+        fy[i] = ps[i].y/4.0 + 1.9;
+    }
+    perlin::fBM(fx.data(), fy.data(), seed + 4, 5, count, dy.data());
+
+    vector<dungeon_feature_type> feats(count);
+    vector<uint32_t> changepoints(count);
+    vector<coord_def> rest;
+    vector<int> rest_index;
+    for (int i = 0; i < count; ++i)
+    {
+        const double x = (ps[i].x + dx[i] * 3) / RIVER_SCALAR;
+        const double y = (ps[i].y + dy[i] * 3) / RIVER_SCALAR;
+        worley::noise_datum n = worley::noise(x, y,
+                                              offset / RIVER_SCALE + seed);
+        feats[i] = _river(ps[i], offset, n, changepoints[i]);
+        if (feats[i] == DNGN_UNSEEN)
+        {
+            changepoints[i] = UINT32_MAX;
+            rest.push_back(ps[i]);
+            rest_index.push_back(i);
+        }
+    }
+    _sample_into(layout, rest, rest_index, offset, feats, changepoints);
+    _fill_samples(ps, feats, changepoints, out);
 }
 
 ProceduralSample
@@ -291,6 +424,30 @@ LevelLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, feat, offset + 4096);
 }
 
+void LevelLayout::sample_all(const vector<coord_def> &ps,
+    const uint32_t offset, vector<ProceduralSample> &out) const
+{
+    const int count = ps.size();
+    vector<dungeon_feature_type> feats(count);
+    vector<uint32_t> changepoints(count);
+    vector<coord_def> rest;
+    vector<int> rest_index;
+    for (int i = 0; i < count; ++i)
+    {
+        feats[i] = grid(clip(ps[i]));
+        if (feats[i] == DNGN_UNSEEN)
+        {
+            changepoints[i] = UINT32_MAX;
+            rest.push_back(ps[i]);
+            rest_index.push_back(i);
+        }
+        else
+            changepoints[i] = offset + 4096;
+    }
+    _sample_into(layout, rest, rest_index, offset, feats, changepoints);
+    _fill_samples(ps, feats, changepoints, out);
+}
+
 ProceduralSample
 NoiseLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
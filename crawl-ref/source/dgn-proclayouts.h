@@ -58,6 +58,11 @@ class ProceduralLayout
     public:
         virtual ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const = 0;
+        // The samples for each of ps in turn, exactly as operator() would
+        // give them. Layouts built from others override this to hand each
+        // of those all its points at once, and to batch their noise.
+        virtual void sample_all(const vector<coord_def> &ps,
+            const uint32_t offset, vector<ProceduralSample> &out) const;
         virtual ~ProceduralLayout() { }
 };
 
@@ -101,7 +106,11 @@ class WorleyLayout : public ProceduralLayout
             seed(_seed), layouts(_layouts), scale(_scale) {}
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        void sample_all(const vector<coord_def> &ps, const uint32_t offset,
+            vector<ProceduralSample> &out) const override;
     private:
+        int _choose(const coord_def &p, const worley::noise_datum &n,
+                    coord_def &pd) const;
         const uint32_t seed;
         const vector<const ProceduralLayout*> layouts;
         const float scale;
@@ -154,7 +163,12 @@ class RiverLayout : public ProceduralLayout
             seed(_seed), layout(_layout) {}
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        void sample_all(const vector<coord_def> &ps, const uint32_t offset,
+            vector<ProceduralSample> &out) const override;
     private:
+        dungeon_feature_type _river(const coord_def &p, const uint32_t offset,
+                                    const worley::noise_datum &n,
+                                    uint32_t &changepoint) const;
         const uint32_t seed;
         const ProceduralLayout &layout;
 };
@@ -179,6 +193,8 @@ class LevelLayout : public ProceduralLayout
             const ProceduralLayout &_layout);
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        void sample_all(const vector<coord_def> &ps, const uint32_t offset,
+            vector<ProceduralSample> &out) const override;
     private:
         feature_grid grid;
         uint32_t seed;
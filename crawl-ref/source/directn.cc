@@ -2828,10 +2828,13 @@ static bool _find_monster(const coord_def& where, targ_mode_type mode,
                           bool find_preferred)
 {
     {
+        static lua_hook ch_target_monster("ch_target_monster");
         coord_def dp = grid2player(where);
         // We could pass more info here.
-        maybe_bool x = clua.callmbooleanfn("ch_target_monster", "dd",
-                                           dp.x, dp.y);
+        maybe_bool x = ch_target_monster.active(clua)
+                       ? ch_target_monster.callmbooleanfn(clua, "dd",
+                                                          dp.x, dp.y)
+                       : maybe_bool::maybe;
         if (x.is_bool())
             return bool(x);
     }
@@ -2870,10 +2873,13 @@ static bool _find_monster_expl(const coord_def& where, targ_mode_type mode,
     ASSERT(hitfunc);
 
     {
+        static lua_hook ch_target_monster_expl("ch_target_monster_expl");
         coord_def dp = grid2player(where);
         // We could pass more info here.
-        maybe_bool x = clua.callmbooleanfn("ch_target_monster_expl", "dd",
-                                           dp.x, dp.y);
+        maybe_bool x = ch_target_monster_expl.active(clua)
+                       ? ch_target_monster_expl.callmbooleanfn(clua, "dd",
+                                                               dp.x, dp.y)
+                       : maybe_bool::maybe;
         if (x.is_bool())
             return bool(x);
     }
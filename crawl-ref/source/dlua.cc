@@ -184,7 +184,10 @@ int dlua_chunk::run(CLua &interp)
     if (err)
         return err;
     // callfn returns true on success, but we want to return 0 on success.
-    return check_op(interp, !interp.callfn(nullptr, 0, 0));
+    const bool ok = interp.callfn(nullptr, 0, 0);
+    // The chunk (e.g. an rc file's Lua) may have redefined any of the hooks.
+    ++interp.global_epoch;
+    return check_op(interp, !ok);
 }
 
 int dlua_chunk::load_call(CLua &interp, const char *fn)
@@ -24,6 +24,14 @@ typedef vector<unique_ptr<vault_placement>> vault_placement_refv;
 
 typedef FixedArray< map_cell, GXM, GYM > MapKnowledge;
 
+/**
+ * The env.mons slots in use: handed out by get_free_monster(), copied into,
+ * or loaded with the level, and not reset() since. This is a superset of the
+ * slots holding live monsters, which lets monster_iterator and friends skip
+ * empty slots a word at a time on sparse levels.
+ */
+typedef FixedIndexSet<MAX_MONSTERS> monster_slots;
+
 class final_effect;
 struct crawl_environment
 {
@@ -32,6 +40,7 @@ struct crawl_environment
 
     FixedVector< item_def, MAX_ITEMS >       item;  // item list
     FixedVector< monster, MAX_MONSTERS+2 >   mons;  // monster list, plus anon
+    monster_slots                            mons_used;
 
     feature_grid                             grid;  // terrain grid
     FixedArray<terrain_property_t, GXM, GYM> pgrid; // terrain properties
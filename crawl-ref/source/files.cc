@@ -71,6 +71,7 @@
 #include "mon-death.h"
 #include "mon-place.h"
 #include "nearby-danger.h"
+#include "ng-setup.h"
 #include "notes.h"
 #include "place.h"
 #include "prompt.h"
@@ -140,6 +141,7 @@ static bool _ghost_version_compatible(const save_version &version);
 static bool _restore_tagged_chunk(package *save, const string &name,
                                   tag_type tag, const char* complaint);
 static player_save_info _read_character_info(package *save);
+static void _load_level(const level_id &level);
 
 static bool _convert_obsolete_species();
 
@@ -1867,37 +1869,10 @@ static bool _branch_pregenerates(branch_type b)
         branch_generation_order.end(), b) > 0;
 }
 
-/**
-* Generate dungeon branches in a stable order until the level `stopping_point`
-* is found; `stopping_point` will be generated if it doesn't already exist. If
-* it does exist, the function is a noop.
-*
-* If `stopping_point` is not in the generation order, it will be generated on
-* its own.
-*
-* To generate all generatable levels, pass a level_id with NUM_BRANCHES as the
-* branch.
-*
-* @return whether stopping_point generated; if stopping_point is NUM_BRANCHES,
-* whether the full pregen list completed. This will return false if all needed
-* levels are already generated, so the caller should check whether false is an
-* error case or trivial success (using the save chunk).
-*/
-bool pregen_dungeon(const level_id &stopping_point)
+// The levels pregen_dungeon() needs to build to get to `stopping_point`, in
+// the order it builds them in.
+static vector<level_id> _pregen_sequence(const level_id &stopping_point)
 {
-    // TODO: the is_valid() check here doesn't look quite right to me, but so
-    // far I can't get it to break anything...
-    if (stopping_point.is_valid()
-        || stopping_point.branch != NUM_BRANCHES &&
-           is_random_subbranch(stopping_point.branch) && you.wizard)
-    {
-        if (you.save->has_chunk(stopping_point.describe()))
-            return false;
-
-        if (!_branch_pregenerates(stopping_point.branch))
-            return generate_level(stopping_point);
-    }
-
     vector<level_id> to_generate;
     bool at_end = false;
     for (auto br : branch_generation_order)
@@ -1939,6 +1914,41 @@ bool pregen_dungeon(const level_id &stopping_point)
         if (at_end)
             break;
     }
+    return to_generate;
+}
+
+/**
+* Generate dungeon branches in a stable order until the level `stopping_point`
+* is found; `stopping_point` will be generated if it doesn't already exist. If
+* it does exist, the function is a noop.
+*
+* If `stopping_point` is not in the generation order, it will be generated on
+* its own.
+*
+* To generate all generatable levels, pass a level_id with NUM_BRANCHES as the
+* branch.
+*
+* @return whether stopping_point generated; if stopping_point is NUM_BRANCHES,
+* whether the full pregen list completed. This will return false if all needed
+* levels are already generated, so the caller should check whether false is an
+* error case or trivial success (using the save chunk).
+*/
+bool pregen_dungeon(const level_id &stopping_point)
+{
+    // TODO: the is_valid() check here doesn't look quite right to me, but so
+    // far I can't get it to break anything...
+    if (stopping_point.is_valid()
+        || stopping_point.branch != NUM_BRANCHES &&
+           is_random_subbranch(stopping_point.branch) && you.wizard)
+    {
+        if (you.save->has_chunk(stopping_point.describe()))
+            return false;
+
+        if (!_branch_pregenerates(stopping_point.branch))
+            return generate_level(stopping_point);
+    }
+
+    const vector<level_id> to_generate = _pregen_sequence(stopping_point);
 
     if (to_generate.size() == 0)
     {
@@ -1989,6 +1999,248 @@ bool pregen_dungeon(const level_id &stopping_point)
     }
 }
 
+// How far down the current branch pregen_next_level() builds.
+#define PREGEN_LOOKAHEAD 2
+
+// Set once a background build fails, for the rest of the game; see
+// reset_background_pregen().
+static bool _pregen_failed = false;
+
+/// Start a new or restored game with background pregeneration enabled again.
+void reset_background_pregen()
+{
+    _pregen_failed = false;
+}
+
+/**
+ * Build the next level the player is likely to need, while they're idle at
+ * the command prompt (`pregen_dungeon = background`). This is the first level
+ * that pregen_dungeon() would build when going down the current branch, so
+ * the levels come out the same as if they had been built on the stairs. The
+ * current level is saved, and reloaded afterwards.
+ *
+ * @return whether a level was built; false if there's nothing more to do.
+ */
+bool pregen_next_level()
+{
+    if (Options.pregen_dungeon != level_gen_type::background
+        || _pregen_failed
+        || !you.save
+        || !you.on_current_level
+        || crawl_state.generating_level
+        || !level_excursions_allowed()
+        || !is_connected_branch(you.where_are_you)
+        || !_branch_pregenerates(you.where_are_you)
+        || env.level_state & LSTATE_DELETED)
+    {
+        return false;
+    }
+
+    const level_id here = level_id::current();
+    const level_id ahead(here.branch, min(here.depth + PREGEN_LOOKAHEAD,
+                                          brdepth[here.branch]));
+    if (ahead == here)
+        return false;
+    const vector<level_id> to_generate = _pregen_sequence(ahead);
+    if (to_generate.empty())
+        return false;
+
+    dprf("Pregenerating %s in the background.",
+         to_generate[0].describe().c_str());
+
+    // Building and reloading the level both reset these, but idling at the
+    // prompt mustn't change anything the player can see.
+    const auto prev_targ = you.prev_targ;
+    const coord_def prev_grd_targ = you.prev_grd_targ;
+    const vector<coord_def> travel_trail = env.travel_trail;
+
+    save_level(here);
+    if (!generate_level(to_generate[0]))
+    {
+        // Leave it for the stairs, which know how to deal with this.
+        _pregen_failed = true;
+    }
+
+    // As level_excursion would. Reactivating the markers also registers
+    // the level's dungeon_events listeners again.
+    _load_level(here);
+    travel_cache.get_level_info(here).set_level_excludes();
+    you.on_current_level = true;
+    env.markers.activate_all(false);
+
+    you.prev_targ = prev_targ;
+    you.prev_grd_targ = prev_grd_targ;
+    env.travel_trail = travel_trail;
+#ifdef USE_TILE_WEB
+    for (coord_def c : env.travel_trail)
+        tiles.update_minimap(c);
+#endif
+    return !_pregen_failed;
+}
+
+#ifdef DEBUG_TESTS
+// Build the first levels of the dungeon for a seed, either all at once or in
+// the background from D:1, and return what got saved for them.
+static map<string, vector<unsigned char>> _pregen_test_levels(uint64_t seed,
+                                                              bool background)
+{
+    unwind_var<uint64_t> saved_seed(Options.seed, seed);
+    unwind_var<level_gen_type> mode(Options.pregen_dungeon,
+                                    level_gen_type::background);
+    unwind_bool deterministic(you.deterministic_levelgen, true);
+    unwind_var<branch_type> branch(you.where_are_you);
+    unwind_var<int> depth(you.depth);
+    unwind_bool on_level(you.on_current_level);
+    unwind_bool failed(_pregen_failed, false);
+    unique_ptr<package> save(new package());
+    unwind_var<package*> you_save(you.save, save.get());
+
+    rng::reset();
+    initial_dungeon_setup();
+    const level_id start(BRANCH_DUNGEON, 1);
+    if (background)
+    {
+        pregen_dungeon(start);
+        _load_level(start);
+        you.on_current_level = true;
+        // A keypress waits for the build in progress, so each call must
+        // build no more than one level.
+        for (size_t built = save->list_chunks().size(); pregen_next_level();)
+        {
+            const size_t now = save->list_chunks().size();
+            if (now > built + 1)
+            {
+                fail("seed %" PRIu64 ": built %d levels in one idle step",
+                     seed, (int)(now - built));
+            }
+            built = now;
+        }
+    }
+    else
+        pregen_dungeon(level_id(BRANCH_DUNGEON, 1 + PREGEN_LOOKAHEAD));
+
+    map<string, vector<unsigned char>> levels;
+    for (const string &name : save->list_chunks())
+    {
+        // The start level has been through a save/load cycle, so it isn't
+        // comparable byte for byte.
+        if (name == start.describe())
+            continue;
+        chunk_reader rd(save.get(), name);
+        rd.read_all(levels[name]);
+    }
+    return levels;
+}
+
+// What the player can see of the level they're on: where they are, their
+// targets, the map they know and the monsters on it.
+static string _player_view()
+{
+    string view = make_stringf("%s (%d,%d) targ %d (%d,%d) trail %d\n",
+                               level_id::current().describe().c_str(),
+                               you.pos().x, you.pos().y, (int)you.prev_targ,
+                               you.prev_grd_targ.x, you.prev_grd_targ.y,
+                               (int)env.travel_trail.size());
+    for (rectangle_iterator ri(0); ri; ++ri)
+    {
+        view += make_stringf("%d/%d", env.grid(*ri),
+                             env.map_knowledge(*ri).feat());
+        if (const monster *mon = monster_at(*ri))
+            view += make_stringf("/%d:%d", mon->type, mon->hit_points);
+        view += ' ';
+    }
+    return view;
+}
+
+// Start a game on D:1 for a seed, optionally idle there long enough to
+// build everything in the background, then take the stairs down to D:2 the
+// usual way. Returns what the player sees on D:2.
+static string _pregen_test_descent(uint64_t seed, bool background)
+{
+    unwind_var<uint64_t> saved_seed(Options.seed, seed);
+    unwind_var<level_gen_type> mode(Options.pregen_dungeon,
+                                    level_gen_type::background);
+    unwind_bool deterministic(you.deterministic_levelgen, true);
+    unwind_var<branch_type> branch(you.where_are_you);
+    unwind_var<int> depth(you.depth);
+    unwind_bool on_level(you.on_current_level);
+    unwind_var<coord_def> pos(you.position);
+    unwind_var<CrawlHashTable> props(you.props);
+    unwind_bool failed(_pregen_failed, false);
+    unique_ptr<package> save(new package());
+    unwind_var<package*> you_save(you.save, save.get());
+
+    you.props.erase(VISITED_LEVELS_KEY);
+    rng::reset();
+    initial_dungeon_setup();
+    const level_id start(BRANCH_DUNGEON, 1);
+    you.where_are_you = start.branch;
+    you.depth = start.depth;
+    pregen_dungeon(start);
+    _load_level(start);
+    you.on_current_level = true;
+    you.set_level_visited(start);
+    for (rectangle_iterator ri(0); ri; ++ri)
+    {
+        if (env.grid(*ri) == DNGN_STONE_STAIRS_DOWN_I)
+        {
+            you.moveto(*ri);
+            break;
+        }
+    }
+
+    // Something for pregen to leave alone.
+    you.prev_grd_targ = you.pos();
+    env.travel_trail.push_back(you.pos());
+
+    if (background)
+    {
+        const string before = _player_view();
+        while (pregen_next_level())
+            ;
+        if (_player_view() != before)
+        {
+            fail("seed %" PRIu64 ": idling on D:1 changed what the player "
+                 "sees", seed);
+        }
+    }
+
+    you.depth = start.depth + 1;
+    load_level(DNGN_STONE_STAIRS_DOWN_I, LOAD_ENTER_LEVEL, start);
+    return _player_view();
+}
+
+void pregen_tests()
+{
+    for (uint64_t seed = 1; seed <= 3; seed++)
+    {
+        const auto sync = _pregen_test_levels(seed, false);
+        const auto background = _pregen_test_levels(seed, true);
+        if (sync.empty() || sync.size() != background.size())
+        {
+            fail("seed %" PRIu64 ": built %d levels, %d in the background",
+                 seed, (int)sync.size(), (int)background.size());
+        }
+        for (const auto &level : sync)
+        {
+            const auto *other = map_find(background, level.first);
+            if (!other || *other != level.second)
+            {
+                fail("seed %" PRIu64 ": %s differs when built in the "
+                     "background", seed, level.first.c_str());
+            }
+        }
+
+        if (_pregen_test_descent(seed, false)
+            != _pregen_test_descent(seed, true))
+        {
+            fail("seed %" PRIu64 ": D:2 looks different after idling on D:1",
+                 seed);
+        }
+    }
+}
+#endif
+
 static void _rescue_player_from_wall()
 {
     // n.b. you.wizmode_teleported_into_rock would be better, but it is not
@@ -91,6 +91,11 @@ void update_portal_entrances();
 void reset_portal_entrances();
 bool generate_level(const level_id &l);
 bool pregen_dungeon(const level_id &stopping_point);
+bool pregen_next_level();
+void reset_background_pregen();
+#ifdef DEBUG_TESTS
+void pregen_tests();
+#endif
 bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
                 const level_id& old_level);
 void delete_level(const level_id &level);
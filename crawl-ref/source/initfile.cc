@@ -55,6 +55,7 @@
 #include "monster.h"
 #include "newgame.h"
 #include "options.h"
+#include "package.h"
 #include "playable.h"
 #include "player.h"
 #include "prompt.h"
@@ -762,6 +763,7 @@ const vector<GameOption*> game_options::build_options_list()
             SIMPLE_NAME(pregen_dungeon),
             level_gen_type::incremental,
             {{"incremental", level_gen_type::incremental},
+             {"background", level_gen_type::background},
 #ifndef DGAMELAUNCH
              {"true", level_gen_type::full},
              {"full", level_gen_type::full},
@@ -936,6 +938,7 @@ const vector<GameOption*> game_options::build_options_list()
         new MultipleChoiceGameOption<string>(
             SIMPLE_NAME(tile_web_mobile_input_helper), "auto",
             {{"auto", "auto"}, {"true", "true"}, {"false", "false"}}),
+        new BoolGameOption(SIMPLE_NAME(tile_web_packed_map), true),
         new StringGameOption(SIMPLE_NAME(tile_font_crt_family), "monospace", true),
         new StringGameOption(SIMPLE_NAME(tile_font_msg_family), "monospace", true),
         new StringGameOption(SIMPLE_NAME(tile_font_stat_family), "monospace", true),
@@ -2220,6 +2223,7 @@ void base_game_options::reset_loaded_state()
 
 void base_game_options::merge(const base_game_options &other)
 {
+    ++generation;
     for (auto *o : option_behaviour)
     {
         if (o->was_loaded())
@@ -2541,7 +2545,8 @@ base_game_options::base_game_options()
     : prefs_dirty(false),
       filename("unknown"),
       basefilename("unknown"),
-      line_num(-1)
+      line_num(-1),
+      generation(0)
 {
     // no explicit reset_options call in base class
 }
@@ -2561,10 +2566,11 @@ void base_game_options::reset_options()
     filename = "unknown";
     basefilename = "unknown";
     line_num = -1;
-
+    ++generation;
 }
 
 base_game_options::base_game_options(base_game_options const& other)
+    : generation(0)
 {
     *this = other;
 }
@@ -2590,6 +2596,7 @@ base_game_options& base_game_options::operator=(base_game_options const& other)
         basefilename = other.basefilename;
         line_num = other.line_num;
         prefs_dirty = other.prefs_dirty; // ??
+        ++generation;
     }
     return *this;
 }
@@ -3650,6 +3657,7 @@ void base_game_options::set_from_defaults(const string &opt)
 ///             starting up a game.
 void base_game_options::read_option_line(const string &str, bool runscripts)
 {
+    ++generation;
     opt_parse_state state = parse_option_line(str);
     if (!state.is_valid_option_line())
         return; // either invalid, or already handled directive
@@ -4583,6 +4591,7 @@ enum commandline_option_type
     CLO_MAPSTAT_DUMP_DISCONNECT,
     CLO_OBJSTAT,
     CLO_ITERATIONS,
+    CLO_JOBS,
     CLO_FORCE_MAP,
     CLO_ARENA,
     CLO_DUMP_MAPS,
@@ -4610,6 +4619,9 @@ enum commandline_option_type
     CLO_THROTTLE,
     CLO_NO_THROTTLE,
     CLO_CLUA_MAX_MEMORY,
+    CLO_SAVE_THREADS,
+    CLO_SAVE_MMAP,
+    CLO_SAVE_DELTAS,
     CLO_PLAYABLE_JSON, // JSON metadata for species, jobs, combos.
     CLO_BRANCHES_JSON, // JSON metadata for branches.
     CLO_SAVE_JSON,
@@ -4623,6 +4635,10 @@ enum commandline_option_type
     CLO_WEBTILES_SOCKET,
     CLO_AWAIT_CONNECTION,
     CLO_PRINT_WEBTILES_OPTIONS,
+#endif
+#ifdef UNIX
+    CLO_ZYGOTE,
+    CLO_ZYGOTE_CONNECT,
 #endif
     CLO_RESET_CACHE,
 
@@ -4663,18 +4679,23 @@ static const char *cmd_ops[] =
 {
     "scores", "name", "species", "background", "dir", "rc", "rcdir", "tscores",
     "vscores", "scorefile", "morgue", "macro", "mapstat", "dump-disconnect",
-    "objstat", "iters", "force-map", "arena", "dump-maps", "test", "script",
+    "objstat", "iters", "jobs", "force-map", "arena", "dump-maps", "test", "script",
     "builddb", "help", "version", "seed", "pregen", "save-version", "sprint",
     "extra-opt-first", "extra-opt-last", "sprint-map", "edit-save",
     "print-charset", "tutorial", "wizard", "explore", "no-save",
     "no-player-bones", "gdb", "no-gdb", "nogdb", "throttle", "no-throttle",
-    "lua-max-memory", "playable-json", "branches-json", "save-json",
+    "lua-max-memory", "save-threads", "save-mmap",
+    "save-deltas",
+    "playable-json", "branches-json", "save-json",
     "gametypes-json", "bones", "descent",
 #if defined(UNIX) || defined(USE_TILE_LOCAL)
     "headless",
 #endif
 #ifdef USE_TILE_WEB
     "webtiles-socket", "await-connection", "print-webtiles-options",
+#endif
+#ifdef UNIX
+    "zygote", "zygote-connect",
 #endif
     "reset-cache",
 };
@@ -5495,6 +5516,7 @@ bool parse_args(int argc, char **argv, bool rc_only)
 
     SysEnv.rcdirs.clear();
     SysEnv.map_gen_iters = 0;
+    SysEnv.map_gen_jobs = 1;
 
     if (argc < 2)           // no args!
         return true;
@@ -5675,6 +5697,20 @@ bool parse_args(int argc, char **argv, bool rc_only)
 #endif
             break;
 
+        case CLO_JOBS:
+#ifdef DEBUG_STATISTICS
+            if (!next_is_param || !isadigit(*next_arg))
+                end(1, false, "Integer argument required for -%s\n", arg);
+            else
+            {
+                SysEnv.map_gen_jobs = max(1, min(atoi(next_arg), 256));
+                nextUsed = true;
+            }
+#else
+            end(1, false, "%s", dbg_stat_err);
+#endif
+            break;
+
         case CLO_FORCE_MAP:
 #ifdef DEBUG_STATISTICS
             if (!next_is_param)
@@ -5976,6 +6012,22 @@ bool parse_args(int argc, char **argv, bool rc_only)
             break;
 #endif
 
+#ifdef UNIX
+        case CLO_ZYGOTE:
+        case CLO_ZYGOTE_CONNECT:
+            if (!next_is_param)
+                end(1, false, "Socket path required for -%s\n", arg);
+            else
+            {
+                if (o == CLO_ZYGOTE)
+                    SysEnv.zygote_socket = next_arg;
+                else
+                    SysEnv.zygote_connect = next_arg;
+                nextUsed = true;
+            }
+            break;
+#endif
+
         case CLO_PRINT_CHARSET:
             if (rc_only)
                 break;
@@ -6006,6 +6058,27 @@ bool parse_args(int argc, char **argv, bool rc_only)
             nextUsed = true;
             break;
 
+        case CLO_SAVE_THREADS:
+        {
+            if (!next_is_param)
+                return false;
+
+            int threads;
+            if (!sscanf(next_arg, "%d", &threads) || threads < 0)
+                return false;
+            package::set_compression_threads(threads);
+            nextUsed = true;
+            break;
+        }
+
+        case CLO_SAVE_MMAP:
+            package::set_mmap(true);
+            break;
+
+        case CLO_SAVE_DELTAS:
+            package::set_delta_saves(true);
+            break;
+
         case CLO_EXTRA_OPT_FIRST:
             if (!next_is_param)
                 return false;
@@ -61,11 +61,17 @@ public:
     vector<string> cmd_args;
 
     int map_gen_iters;
+    int map_gen_jobs;              // Worker processes for mapstat/objstat.
     unique_ptr<depth_ranges> map_gen_range;
 
     vector<string> extra_opts_first;
     vector<string> extra_opts_last;
 
+#ifdef UNIX
+    string zygote_socket;          // Serve games forked from this process.
+    string zygote_connect;         // Launch the game through this zygote.
+#endif
+
 public:
     void add_rcdir(const string &dir);
 };
@@ -27,6 +27,7 @@
 #include "evoke.h"
 #include "god-item.h"
 #include "god-passive.h" // passive_t::want_curses, no_haste
+#include "hash.h"
 #include "invent.h"
 #include "item-prop.h"
 #include "item-status-flag-type.h"
@@ -96,6 +97,112 @@ static const char* _interesting_origin(const item_def &item)
     return nullptr;
 }
 
+/**
+ * Everything the name of an ordinary item depends on: its own fields,
+ * whether its type is known, the options, and how it's being described.
+ * Artefacts, corpses and the like also depend on their props or on the
+ * player, so they aren't named from the cache.
+ */
+struct item_name_key
+{
+    object_class_type base_type;
+    int sub_type;
+    int plus;
+    int plus2;
+    int special;
+    int rnd;
+    int quantity;
+    iflags_t flags;
+    int pos_x, pos_y;
+    int link;
+    int orig_branch, orig_depth;
+    int orig_monnum;
+    bool type_known;
+    description_level_type descrip;
+    bool terse;
+    bool ident;
+    bool with_inscription;
+    bool quantity_in_words;
+    iflags_t ignore_flags;
+    unsigned int options_generation;
+};
+
+struct item_name_entry
+{
+    bool used;
+    item_name_key key;
+    string inscription;
+    string name;
+};
+
+static const int ITEM_NAME_CACHE_SIZE = 512;
+static item_name_entry item_name_cache[ITEM_NAME_CACHE_SIZE];
+
+static bool _name_cacheable(const item_def &item, description_level_type desc)
+{
+    // DESC_INVENTORY_EQUIP says how the player is using the item.
+    if (desc == DESC_INVENTORY_EQUIP || is_artefact(item)
+        || !item.props.empty())
+    {
+        return false;
+    }
+
+    switch (item.base_type)
+    {
+    case OBJ_WEAPONS:
+    case OBJ_MISSILES:
+    case OBJ_ARMOUR:
+    case OBJ_WANDS:
+    case OBJ_SCROLLS:
+    case OBJ_JEWELLERY:
+    case OBJ_POTIONS:
+    case OBJ_STAVES:
+    case OBJ_GOLD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static item_name_entry &_name_cache_entry(const item_def &item,
+                                          description_level_type descrip,
+                                          bool terse, bool ident,
+                                          bool with_inscription,
+                                          bool quantity_in_words,
+                                          iflags_t ignore_flags,
+                                          item_name_key &key)
+{
+    // Zero the padding too, so keys can be hashed and compared as bytes.
+    memset(&key, 0, sizeof(key));
+    key.base_type = item.base_type;
+    key.sub_type = item.sub_type;
+    key.plus = item.plus;
+    key.plus2 = item.plus2;
+    key.special = item.special;
+    key.rnd = item.rnd;
+    key.quantity = item.quantity;
+    key.flags = item.flags;
+    key.pos_x = item.pos.x;
+    key.pos_y = item.pos.y;
+    key.link = item.link;
+    key.orig_branch = item.orig_place.branch;
+    key.orig_depth = item.orig_place.depth;
+    key.orig_monnum = item.orig_monnum;
+    key.type_known = item_type_known(item);
+    key.descrip = descrip;
+    key.terse = terse;
+    key.ident = ident;
+    key.with_inscription = with_inscription;
+    key.quantity_in_words = quantity_in_words;
+    key.ignore_flags = ignore_flags;
+    key.options_generation = Options.generation;
+
+    const uint32_t hash = hash32(&key, sizeof(key))
+                          ^ hash32(item.inscription.data(),
+                                   item.inscription.length());
+    return item_name_cache[hash % ITEM_NAME_CACHE_SIZE];
+}
+
 /**
  * What inscription should be appended to the given item's name?
  */
@@ -142,6 +249,20 @@ string item_def::name(description_level_type descrip, bool terse, bool ident,
     if (descrip == DESC_NONE)
         return "";
 
+    item_name_key key;
+    item_name_entry *cached = nullptr;
+    if (_name_cacheable(*this, descrip))
+    {
+        cached = &_name_cache_entry(*this, descrip, terse, ident,
+                                    with_inscription, quantity_in_words,
+                                    ignore_flags, key);
+        if (cached->used && !memcmp(&cached->key, &key, sizeof(key))
+            && cached->inscription == inscription)
+        {
+            return cached->name;
+        }
+    }
+
     ostringstream buff;
 
     const string auxname = name_aux(descrip, terse, ident, with_inscription,
@@ -340,6 +461,14 @@ string item_def::name(description_level_type descrip, bool terse, bool ident,
         buff << " (curse)";
     }
 
+    if (cached)
+    {
+        cached->used = true;
+        cached->key = key;
+        cached->inscription = inscription;
+        cached->name = buff.str();
+        return cached->name;
+    }
     return buff.str();
 }
 
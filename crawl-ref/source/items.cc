@@ -3005,6 +3005,12 @@ static int _autopickup_subtype(const item_def &item)
     }
 }
 
+static const text_pattern &_autopickup_pattern(
+    const pair<text_pattern, bool> &option)
+{
+    return option.first;
+}
+
 static bool _is_option_autopickup(const item_def &item, bool ignore_force)
 {
     if (item.base_type < NUM_OBJECT_CLASSES)
@@ -3022,8 +3028,13 @@ static bool _is_option_autopickup(const item_def &item, bool ignore_force)
                                                 ? "{gold}"
                                                 : _autopickup_item_name(item);
 
-    maybe_bool res = clua.callmaybefn("ch_force_autopickup", "is",
-                                      &item, iname.c_str());
+    static lua_hook ch_force_autopickup("ch_force_autopickup");
+    maybe_bool res = maybe_bool::maybe;
+    if (ch_force_autopickup.active(clua))
+    {
+        res = ch_force_autopickup.callmaybefn(clua, "is",
+                                              &item, iname.c_str());
+    }
     if (!clua.error.empty())
     {
         mprf(MSGCH_ERROR, "ch_force_autopickup failed: %s",
@@ -3034,9 +3045,16 @@ static bool _is_option_autopickup(const item_def &item, bool ignore_force)
         return bool(res);
 
     // Check for initial settings
-    for (const pair<text_pattern, bool>& option : Options.force_autopickup)
-        if (option.first.matches(iname))
-            return option.second;
+    static cached_pattern_set patterns;
+    const auto &force = Options.force_autopickup;
+    const pattern_set &forced = patterns.get(force, Options.generation,
+                                             _autopickup_pattern);
+    const int i = forced.first_match(iname, [&](int j)
+        {
+            return force[j].first.matches(iname);
+        });
+    if (i >= 0)
+        return force[i].second;
 
     return Options.autopickups[item.base_type];
 }
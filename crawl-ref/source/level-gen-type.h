@@ -5,6 +5,8 @@ enum class level_gen_type
 {
     incremental, // generate levels in a stable order, catching
                  // up as needed when entering a new level
+    background,  // as incremental, but also build the next levels while
+                 // waiting for a command
     full,        // generate all levels in advance
     classic,     // generate levels when entered; breaks seeding
 };
@@ -153,6 +153,7 @@
 #include "wizard.h" // handle_wizard_command() and enter_explore_mode()
 #include "xom.h" // XOM_CLOUD_TRAIL_TYPE_KEY
 #include "zot.h"
+#include "zygote.h"
 
 // ----------------------------------------------------------------------
 // Globals whose construction/destruction order needs to be managed
@@ -282,6 +283,11 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+#ifdef UNIX
+    if (!SysEnv.zygote_connect.empty())
+        zygote_connect(SysEnv.zygote_connect, argc, argv);
+#endif
+
     // Init monsters up front - needed to handle the mon_glyph option right.
     init_char_table(CSET_ASCII);
     init_monsters();
@@ -294,6 +300,21 @@ int main(int argc, char *argv[])
     // make sure all the expected data directories exist
     validate_basedirs();
 
+#ifdef UNIX
+    if (!SysEnv.zygote_socket.empty())
+    {
+        // Each game forked by the zygote carries on from here, with the
+        // command line it was launched with.
+        zygote_serve(SysEnv.zygote_socket, argc, argv);
+        if (!parse_args(argc, argv, true))
+        {
+            _show_commandline_options_help();
+            return 1;
+        }
+        validate_basedirs();
+    }
+#endif
+
     {
         // Read the init file -- first pass. This pass ignores lua. It'll get
         // reread with lua on starting a game.
@@ -537,6 +558,9 @@ static void _show_commandline_options_help()
     puts("  -lua-max-memory       max memory in MB allowed for user Lua scripts");
     puts("  -seed <number>        specify a game seed to use when creating a new game");
 #endif
+    puts("  -save-threads <num>   compress save data on <num> worker threads");
+    puts("  -save-mmap            read save data through a memory mapping");
+    puts("  -save-deltas          save only the changed parts of the game");
 
     puts("");
 
@@ -568,6 +592,12 @@ static void _show_commandline_options_help()
     // XX should this really be advertised outside of debug builds?
     puts("  -headless           force headless mode (no pty)");
     puts("  -script <name>      run script matching <name> in ./scripts");
+#ifdef UNIX
+    puts("  -zygote <socket>    load data once, then fork a game for each "
+         "launcher");
+    puts("  -zygote-connect <socket>  start this game from the zygote at "
+         "<socket>");
+#endif
 #ifdef DEBUG_STATISTICS
 #ifndef DEBUG_DIAGNOSTICS
     puts("");
@@ -585,6 +615,9 @@ static void _show_commandline_options_help()
     puts("      Defaults to entire dungeon; same level syntax as -mapstat.");
     puts("  -iters <num>        For -mapstat and -objstat, set the number of "
          "iterations");
+    puts("  -jobs <num>         For -mapstat and -objstat, split the iterations "
+         "over this many");
+    puts("      worker processes, seeded from -seed, and merge their stats");
     puts("  -force-map <map>    For -mapstat and -objstat, always choose the "
          "      given map on every level.");
 #endif
@@ -1198,7 +1231,9 @@ static void _input()
                 mprf(MSGCH_ERROR, "Infinite lua loop detected, aborting.");
             else if (!crawl_state.lua_ready_throttled)
             {
-                if (!clua.callfn("ready", 0, 0) && !clua.error.empty())
+                static lua_hook ready("ready");
+                if (ready.active(clua) && !ready.callfn(clua, 0, 0)
+                    && !clua.error.empty())
                 {
                     // if ready() has been killed once, it is considered
                     // buggy and should not run again. Note: the sequencing is
@@ -2643,8 +2678,11 @@ void world_reacts()
 
     add_auto_excludes();
 
-    viewwindow();
-    update_screen();
+    if (!crawl_state.arena_batch)
+    {
+        viewwindow();
+        update_screen();
+    }
 
     if (you.cannot_act() && any_messages()
         && crawl_state.repeat_cmd != CMD_WIZARD)
@@ -2742,11 +2780,31 @@ static command_type _keycode_to_command(keycode_type key)
     }
 }
 
+// Use the time the player spends thinking to build the levels they're likely
+// to go to next (pregen_dungeon = background). This runs on the main thread,
+// since the builder uses the game's globals, and input is only checked
+// between levels: a keypress can wait for one whole level build, which is
+// usually tens of milliseconds but can reach a few hundred for big or
+// vault-heavy levels. The pregen test checks that each step builds at most
+// one level.
+static void _pregen_while_idle()
+{
+    if (Options.pregen_dungeon != level_gen_type::background)
+        return;
+
+    while (!get_macro_buf_size() && !kbhit() && pregen_next_level())
+    {
+        viewwindow();
+        update_screen();
+    }
+}
+
 static keycode_type _get_next_keycode()
 {
     keycode_type keyin = 0;
 
     flush_input_buffer(FLUSH_BEFORE_COMMAND);
+    _pregen_while_idle();
 
     mouse_control mc(MOUSE_MODE_COMMAND);
     for (;;)
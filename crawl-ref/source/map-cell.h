@@ -123,6 +123,29 @@ struct map_cell
         *this = map_cell();
     }
 
+    // Copy only the terrain, flags and cloud of another cell, leaving out
+    // its monster and item. For caches that only look at the terrain, like
+    // packed_cell's, so refreshing them doesn't allocate a copy of every
+    // remembered item on the level. Reuses this cell's cloud, if any.
+    void copy_terrain(const map_cell& c)
+    {
+        if (&c == this)
+            return;
+        clear_monster();
+        clear_item();
+        flags = c.flags & ~(MAP_DETECTED_MONSTER | MAP_INVISIBLE_MONSTER
+                            | MAP_DETECTED_ITEM | MAP_MORE_ITEMS);
+        _feat = c._feat;
+        _feat_colour = c._feat_colour;
+        _trap = c._trap;
+        if (!c._cloud)
+            clear_cloud();
+        else if (_cloud)
+            *_cloud = *c._cloud;
+        else
+            _cloud = new cloud_info(*c._cloud);
+    }
+
     // Clear prior to show update. Need to retain at least "seen" flag.
     void clear_data()
     {
@@ -209,6 +232,12 @@ struct map_cell
         _mons = new monster_info(mi);
     }
 
+    void set_monster(monster_info&& mi)
+    {
+        clear_monster();
+        _mons = new monster_info(move(mi));
+    }
+
     bool detected_monster() const
     {
         return !!(flags & MAP_DETECTED_MONSTER);
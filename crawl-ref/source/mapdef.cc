@@ -2183,6 +2183,16 @@ bool depth_ranges::is_usable_in(const level_id &lid) const
     return any_matched;
 }
 
+// A cheap superset of is_usable_in(): true if some level of the branch may
+// be usable, ignoring depths and denials.
+bool depth_ranges::may_be_usable_in(branch_type br) const
+{
+    for (const level_range &lr : depths)
+        if (!lr.deny && (lr.branch == br || lr.branch == NUM_BRANCHES))
+            return true;
+    return false;
+}
+
 void depth_ranges::add_depths(const depth_ranges &other_depths)
 {
     depths.insert(depths.end(),
@@ -2209,7 +2219,8 @@ map_def::map_def()
       rock_colour(BLACK), floor_colour(BLACK), rock_tile(""),
       floor_tile(""), border_fill_type(DNGN_ROCK_WALL),
       tags(),
-      index_only(false), cache_offset(0L), validating_map_flag(false),
+      index_only(false), cache_offset(0L), in_vault_db(false),
+      validating_map_flag(false),
       cache_minivault(false), cache_overwritable(false), cache_extra(false)
 {
     init();
@@ -2469,6 +2480,15 @@ void map_def::load()
     if (!index_only)
         return;
 
+    if (in_vault_db)
+    {
+        // Straight out of the mapping, shared with every other process.
+        size_t size;
+        const unsigned char *db = vault_db_contents(size);
+        load_from(db, size);
+        return;
+    }
+
     const string descache_base = get_descache_path(cache_name, "");
     file_lock deslock(descache_base + ".lk", "rb", false);
     const string loadfile = descache_base + ".dsc";
@@ -2485,6 +2505,23 @@ void map_def::load()
     index_only = false;
 }
 
+// Realise the map from a copy of the file its body is in (its .dsc or the
+// vault database) that is already in memory.
+void map_def::load_from(const unsigned char *data, size_t size)
+{
+    if (!index_only)
+        return;
+
+    if (!data || cache_offset <= 0 || (size_t)cache_offset >= size)
+    {
+        throw map_load_exception(
+                make_stringf("Map body missing: %s", name.c_str()));
+    }
+    reader inf(data + cache_offset, size - cache_offset, TAG_MINOR_VERSION);
+    read_full(inf);
+    index_only = false;
+}
+
 vector<coord_def> map_def::find_glyph(int glyph) const
 {
     return map.find_glyph(glyph);
@@ -977,6 +977,7 @@ public:
     void clear() { depths.clear(); }
     bool empty() const { return depths.empty(); }
     bool is_usable_in(const level_id &lid) const;
+    bool may_be_usable_in(branch_type br) const;
     void add_depth(const level_range &range) { depths.push_back(range); }
     void add_depths(const depth_ranges &other_ranges);
     string describe() const;
@@ -1163,6 +1164,8 @@ private:
     bool            index_only;
     mutable long    cache_offset;
     string          cache_name;
+    // The body is in the compiled vault database, rather than the .dsc.
+    bool            in_vault_db;
 
     typedef Matrix<bool> subvault_mask;
     subvault_mask *svmask;
@@ -1190,6 +1193,7 @@ public:
     void reload_epilogue();
 
     void load();
+    void load_from(const unsigned char *data, size_t size);
     void strip();
 
     int weight(const level_id &lid) const;
@@ -1213,6 +1217,7 @@ public:
     void read_maplines(reader&);
 
     void set_file(const string &s);
+    void set_in_vault_db() { in_vault_db = true; }
     string run_lua(bool skip_main);
     bool run_hook(const string &hook_name, bool die_on_lua_error = false);
     bool run_postplace_hook(bool die_on_lua_error = false);
@@ -12,9 +12,15 @@
 #include <cstring>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <unordered_map>
 #if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
 #include <unistd.h>
 #endif
+#ifdef UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "branch.h"
 #include "coord.h"
@@ -734,13 +740,100 @@ static bool _map_matches_species(const map_def &map)
            + lowercase_string(species::get_abbrev(you.species)));
 }
 
-const map_def *find_map_by_name(const string &name)
+typedef vector<unsigned> vault_indices;
+
+// Lookup tables over vdefs, so that finding candidate vaults doesn't mean
+// testing every map in the game. Each list is sorted by vdefs index, so
+// that intersections of lists come out in the same order as a full scan.
+// The tables only narrow things down: callers still check each candidate.
+struct vault_index
+{
+    bool built = false;
+    size_t nmaps = 0;
+    unordered_map<string, unsigned> by_name;
+    unordered_map<string, vault_indices> by_tag;
+    vault_indices by_minivault[2];
+    vault_indices by_extra[2];
+    // Maps that might be usable somewhere in the branch, by DEPTH or PLACE.
+    vault_indices by_depth[NUM_BRANCHES];
+    vault_indices by_place[NUM_BRANCHES];
+};
+
+static vault_index vindex;
+
+static void _invalidate_vault_index()
 {
-    for (const map_def &mapdef : vdefs)
-        if (mapdef.name == name)
-            return &mapdef;
+    vindex = vault_index();
+}
 
-    return nullptr;
+static const vault_index &_vault_index()
+{
+    if (vindex.built && vindex.nmaps == vdefs.size())
+        return vindex;
+
+    _invalidate_vault_index();
+    for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+    {
+        const map_def &mapdef = vdefs[i];
+        vindex.by_name.emplace(mapdef.name, i);
+        for (const string &tag : mapdef.get_tags_unsorted())
+            vindex.by_tag[tag].push_back(i);
+        vindex.by_minivault[mapdef.is_minivault()].push_back(i);
+        vindex.by_extra[mapdef.is_extra_vault()].push_back(i);
+        for (branch_iterator it; it; ++it)
+        {
+            if (mapdef.depths.may_be_usable_in(it->id))
+                vindex.by_depth[it->id].push_back(i);
+            if (mapdef.place.may_be_usable_in(it->id))
+                vindex.by_place[it->id].push_back(i);
+        }
+    }
+    vindex.built = true;
+    vindex.nmaps = vdefs.size();
+    dprf(DIAG_DNGN, "Indexed %u maps by %u tags",
+         (unsigned int)vindex.nmaps, (unsigned int)vindex.by_tag.size());
+    return vindex;
+}
+
+static vault_indices _intersect(const vault_indices &a,
+                                const vault_indices &b)
+{
+    vault_indices both;
+    set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                     back_inserter(both));
+    return both;
+}
+
+// The maps having every tag in the set; none for an empty set, matching
+// map_def::has_all_tags().
+static vault_indices _maps_with_all_tags(const unordered_set<string> &tags)
+{
+    const vault_index &index = _vault_index();
+    vector<const vault_indices *> lists;
+    for (const string &tag : tags)
+    {
+        const vault_indices *list = map_find(index.by_tag, tag);
+        if (!list)
+            return vault_indices();
+        lists.push_back(list);
+    }
+    if (lists.empty())
+        return vault_indices();
+
+    // Start from the rarest tag to keep the intermediate sets small.
+    sort(lists.begin(), lists.end(),
+         [](const vault_indices *a, const vault_indices *b)
+         { return a->size() < b->size(); });
+    vault_indices maps = *lists[0];
+    for (unsigned i = 1; i < lists.size() && !maps.empty(); ++i)
+        maps = _intersect(maps, *lists[i]);
+    return maps;
+}
+
+const map_def *find_map_by_name(const string &name)
+{
+    const unsigned *index = map_find(_vault_index().by_name, name);
+    return index ? &vdefs[*index] : nullptr;
 }
 
 // Discards Lua code loaded by all maps to reduce memory use. If any stripped
@@ -767,12 +860,11 @@ mapref_vector find_maps_for_tag(const string &tag,
 {
     mapref_vector maps;
     level_id place = level_id::current();
-    unordered_set<string> tag_set = parse_tags(tag);
 
-    for (const map_def &mapdef : vdefs)
+    for (unsigned i : _maps_with_all_tags(parse_tags(tag)))
     {
-        if (mapdef.has_all_tags(tag_set.begin(), tag_set.end())
-            && !mapdef.has_tag("dummy")
+        const map_def &mapdef = vdefs[i];
+        if (!mapdef.has_tag("dummy")
             && (!check_depth || _debug_ignore_depth
                 || !mapdef.has_depth()
                 || mapdef.is_usable_in(place))
@@ -797,6 +889,7 @@ private:
 
 public:
     bool accept(const map_def &md) const;
+    vault_indices candidates() const;
     void announce(const map_def *map) const;
 
     bool valid() const
@@ -952,6 +1045,37 @@ bool map_selector::accept(const map_def &mapdef) const
     }
 }
 
+// A superset of the maps accept() may take, from the vault index.
+vault_indices map_selector::candidates() const
+{
+    const vault_index &index = _vault_index();
+    vault_indices maps;
+
+    switch (sel)
+    {
+    case PLACE:
+    case DEPTH:
+        maps = _intersect(sel == PLACE ? index.by_place[place.branch]
+                                       : index.by_depth[place.branch],
+                          index.by_minivault[mini]);
+        break;
+
+    case DEPTH_AND_CHANCE:
+        maps = index.by_depth[place.branch];
+        break;
+
+    case TAG:
+        return _maps_with_all_tags(parse_tags(tag));
+
+    default:
+        return maps;
+    }
+
+    if (extra != maybe_bool::maybe)
+        maps = _intersect(maps, index.by_extra[bool(extra)]);
+    return maps;
+}
+
 void map_selector::announce(const map_def *vault) const
 {
 #ifdef DEBUG_DIAGNOSTICS
@@ -992,15 +1116,13 @@ string vault_chance_tag(const map_def &map)
     return "";
 }
 
-typedef vector<unsigned> vault_indices;
-
 static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 {
     vault_indices eligible;
 
     if (sel.valid())
     {
-        for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+        for (unsigned i : sel.candidates())
             if (sel.accept(vdefs[i]))
                 eligible.push_back(i);
     }
@@ -1474,14 +1596,8 @@ static void _write_map_cache(const string &filename, size_t vs, size_t ve,
     _write_map_index(descache_base, vs, ve, mtime);
 }
 
-static void _parse_maps(const string &s)
+static void _parse_maps_uncompiled(const string &s, const string &cache_name)
 {
-    string cache_name = get_cache_name(s);
-    if (map_files_read.count(cache_name))
-        return;
-
-    map_files_read.insert(cache_name);
-
     if (_load_map_cache(s, cache_name))
         return;
 
@@ -1511,6 +1627,338 @@ static void _parse_maps(const string &s)
     _write_map_cache(cache_name, file_start, vdefs.size(), mtime);
 }
 
+////////////////////////////////////////////////////////////////////////////
+// The compiled vault database.
+//
+// Once every .des file has been read, the index and body of every map are
+// written to one file, which later processes map read-only and share. They
+// take their map indices from it without opening anything per .des file,
+// and read a map's body straight out of the mapping when it is first used.
+// A .des file that changed since is loaded through its own .idx/.dsc cache,
+// and the database is rewritten at the end of read_maps().
+
+#define VAULT_DB_FILE "vaults.db"
+#define VAULT_DB_MAGIC "CVDB"
+static const int VAULT_DB_VERSION = 1;
+// magic, version, major, minor, word length, table and records offsets
+static const size_t VAULT_DB_HEADER_SIZE = 4 + 4 + 2 + 2 + 1 + 4 + 4;
+
+// A .des file, as stored in the database.
+struct vault_db_entry
+{
+    time_t mtime;
+    dlua_chunk prelude;
+    unsigned nmaps;
+    // Offset of the file's first index record.
+    size_t records;
+};
+
+struct vault_database
+{
+    bool opened = false;
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+#ifndef UNIX
+    vector<unsigned char> contents;
+#endif
+    map<string, vault_db_entry> files;
+};
+
+static vault_database vault_db;
+
+// A .des file read by this process, wherever its maps came from.
+struct des_file_read
+{
+    string cache_name;
+    time_t mtime;
+    dlua_chunk prelude;
+    size_t first_map, nmaps;
+    // The maps' bodies are in the vault database, not the .dsc.
+    bool in_vault_db;
+};
+
+static vector<des_file_read> des_files_read;
+// Some file was not in the database, or had changed.
+static bool vault_db_stale = false;
+
+const unsigned char *vault_db_contents(size_t &size)
+{
+    size = vault_db.size;
+    return vault_db.data;
+}
+
+static void _write_vault_db_header(writer &outf, size_t table, size_t records)
+{
+    outf.write(VAULT_DB_MAGIC, 4);
+    marshallInt(outf, VAULT_DB_VERSION);
+    marshallShort(outf, TAG_MAJOR_VERSION);
+    marshallShort(outf, TAG_MINOR_VERSION);
+    marshallByte(outf, WORD_LEN);
+    marshallInt(outf, table);
+    marshallInt(outf, records);
+}
+
+static void _read_vault_db_table()
+{
+    reader inf(vault_db.data, vault_db.size, TAG_MINOR_VERSION);
+    inf.set_safe_read(true);
+
+    char magic[4];
+    inf.read(magic, sizeof(magic));
+    if (memcmp(magic, VAULT_DB_MAGIC, sizeof(magic))
+        || unmarshallInt(inf) != VAULT_DB_VERSION
+        || unmarshallShort(inf) != TAG_MAJOR_VERSION
+        || unmarshallShort(inf) != TAG_MINOR_VERSION
+        || unmarshallByte(inf) != WORD_LEN)
+    {
+        dprf("Vault database is for another version, ignoring it.");
+        return;
+    }
+    const size_t table = unmarshallInt(inf);
+    const size_t records = unmarshallInt(inf);
+    if (table > records || records > vault_db.size)
+        throw short_read_exception();
+
+    reader tab(vault_db.data + table, records - table, TAG_MINOR_VERSION);
+    tab.set_safe_read(true);
+    for (int nfiles = unmarshallInt(tab); nfiles > 0; --nfiles)
+    {
+        const string name = unmarshallString(tab);
+        vault_db_entry &file = vault_db.files[name];
+        file.mtime = unmarshallSigned(tab);
+        file.prelude.read(tab);
+        file.nmaps = unmarshallInt(tab);
+        file.records = records + unmarshallInt(tab);
+        if (file.records >= vault_db.size && file.nmaps)
+            throw short_read_exception();
+    }
+}
+
+static void _open_vault_db()
+{
+    if (vault_db.opened)
+        return;
+    vault_db.opened = true;
+
+    const string path = _des_cache_dir(VAULT_DB_FILE);
+#ifdef UNIX
+    const int fd = open_u(path.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size > VAULT_DB_HEADER_SIZE)
+    {
+        void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m != MAP_FAILED)
+        {
+            // Never unmapped: maps keep reading their bodies from it, even
+            // after another process has replaced the file.
+            vault_db.data = (const unsigned char *)m;
+            vault_db.size = st.st_size;
+        }
+    }
+    close(fd);
+#else
+    FILE *fp = fopen_u(path.c_str(), "rb");
+    if (!fp)
+        return;
+    unsigned char buf[65536];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        vault_db.contents.insert(vault_db.contents.end(), buf, buf + len);
+    fclose(fp);
+    vault_db.data = vault_db.contents.data();
+    vault_db.size = vault_db.contents.size();
+#endif
+    if (!vault_db.data)
+        return;
+
+    try
+    {
+        _read_vault_db_table();
+    }
+    catch (short_read_exception &E)
+    {
+        dprf("Vault database is truncated, ignoring it.");
+        vault_db.files.clear();
+    }
+}
+
+static bool _load_maps_from_vault_db(const string &cache_name, time_t mtime)
+{
+    const vault_db_entry *file = map_find(vault_db.files, cache_name);
+    if (!file || file->mtime != mtime)
+        return false;
+
+    reader inf(vault_db.data + file->records,
+               vault_db.size - file->records, TAG_MINOR_VERSION);
+    inf.set_safe_read(true);
+
+    const size_t nexist = vdefs.size();
+    vdefs.resize(nexist + file->nmaps, map_def());
+    try
+    {
+        for (unsigned i = 0; i < file->nmaps; ++i)
+        {
+            map_def &vdef(vdefs[nexist + i]);
+            vdef.read_index(inf);
+            vdef.description = unmarshallString(inf);
+            vdef.order = unmarshallInt(inf);
+
+            vdef.set_file(cache_name);
+            vdef.set_in_vault_db();
+            lc_loaded_maps[vdef.name] = vdef.place_loaded_from;
+            vdef.place_loaded_from.clear();
+        }
+    }
+    catch (short_read_exception &E)
+    {
+        dprf("Vault database is corrupt at %s.", cache_name.c_str());
+        vdefs.resize(nexist);
+        return false;
+    }
+
+    if (!file->prelude.empty())
+    {
+        lc_global_prelude = file->prelude;
+        global_preludes.push_back(file->prelude);
+    }
+    return true;
+}
+
+// Reads a whole .dsc file, so that all its maps can be loaded from memory.
+static void _read_map_full(const string &cache_name,
+                           vector<unsigned char> &dsc)
+{
+    const string descache_base = get_descache_path(cache_name, "");
+    file_lock deslock(descache_base + ".lk", "rb", false);
+    const string file = descache_base + ".dsc";
+    FILE *fp = fopen_u(file.c_str(), "rb");
+    if (!fp)
+    {
+        throw map_load_exception(
+                make_stringf("Couldn't open %s", file.c_str()));
+    }
+
+    unsigned char buf[16384];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        dsc.insert(dsc.end(), buf, buf + n);
+    fclose(fp);
+}
+
+static void _write_vault_db()
+{
+    // The map bodies come first, so that write_full() records their offsets
+    // in the file.
+    vector<unsigned char> db(VAULT_DB_HEADER_SIZE), table, records;
+    writer bodies(&db), table_out(&table), records_out(&records);
+
+    marshallInt(table_out, des_files_read.size());
+    try
+    {
+        for (const des_file_read &file : des_files_read)
+        {
+            marshallString(table_out, file.cache_name);
+            marshallSigned(table_out, file.mtime);
+            file.prelude.write(table_out);
+            marshallInt(table_out, file.nmaps);
+            marshallInt(table_out, records.size());
+
+            // Take every body from one copy of the file it's in, rather
+            // than opening the .dsc again for each map.
+            vector<unsigned char> dsc;
+            const unsigned char *source = vault_db.data;
+            size_t source_size = vault_db.size;
+            if (!file.in_vault_db && file.nmaps)
+            {
+                _read_map_full(file.cache_name, dsc);
+                source = dsc.data();
+                source_size = dsc.size();
+            }
+
+            for (size_t i = file.first_map; i < file.first_map + file.nmaps;
+                 ++i)
+            {
+                map_def full = vdefs[i];
+                full.load_from(source, source_size);
+                full.write_full(bodies);
+                if (const map_file_place *place =
+                        map_find(lc_loaded_maps, full.name))
+                {
+                    full.place_loaded_from = *place;
+                }
+                full.write_index(records_out);
+                marshallString(records_out, full.description);
+                marshallInt(records_out, full.order);
+            }
+        }
+    }
+    catch (map_load_exception &E)
+    {
+        dprf("Not writing the vault database: %s", E.what());
+        return;
+    }
+
+    const size_t table_start = db.size();
+    db.insert(db.end(), table.begin(), table.end());
+    const size_t records_start = db.size();
+    db.insert(db.end(), records.begin(), records.end());
+
+    vector<unsigned char> header;
+    writer header_out(&header);
+    _write_vault_db_header(header_out, table_start, records_start);
+    ASSERT(header.size() == VAULT_DB_HEADER_SIZE);
+    copy(header.begin(), header.end(), db.begin());
+
+    // Written aside and renamed into place, so that other processes see
+    // either the old database or the new one.
+    const string path = _des_cache_dir(VAULT_DB_FILE);
+    const string tmp = path + ".tmp";
+    file_lock lock(_des_cache_dir("vaults.lk"), "wb", false);
+    FILE *fp = fopen_u(tmp.c_str(), "wb");
+    if (!fp)
+        return;
+    const bool written = fwrite(db.data(), 1, db.size(), fp) == db.size();
+    if (fclose(fp) || !written || rename_u(tmp.c_str(), path.c_str()))
+    {
+        dprf("Couldn't write the vault database.");
+        unlink_u(tmp.c_str());
+        return;
+    }
+    dprf("Wrote %u maps to the vault database (%u bytes).",
+         (unsigned int)vdefs.size(), (unsigned int)db.size());
+    vault_db_stale = false;
+}
+
+static void _parse_maps(const string &s)
+{
+    string cache_name = get_cache_name(s);
+    if (map_files_read.count(cache_name))
+        return;
+
+    map_files_read.insert(cache_name);
+
+    des_file_read file;
+    file.cache_name = cache_name;
+    file.mtime = file_modtime(s);
+    file.first_map = vdefs.size();
+    const size_t preludes = global_preludes.size();
+
+    file.in_vault_db = crawl_state.use_des_cache
+                       && _load_maps_from_vault_db(cache_name, file.mtime);
+    if (!file.in_vault_db)
+    {
+        vault_db_stale = true;
+        _parse_maps_uncompiled(s, cache_name);
+    }
+
+    file.nmaps = vdefs.size() - file.first_map;
+    if (global_preludes.size() > preludes)
+        file.prelude = global_preludes.back();
+    des_files_read.push_back(file);
+}
+
 void read_map(const string &file)
 {
     _parse_maps(lc_desfile = datafile_path(file));
@@ -1521,9 +1969,18 @@ void read_map(const string &file)
 
 void read_maps()
 {
+    if (crawl_state.use_des_cache)
+    {
+        _check_des_index_dir();
+        _open_vault_db();
+    }
+
     if (dlua.execfile("dlua/loadmaps.lua", true, true, true))
         end(1, false, "Lua error: %s", dlua.error.c_str());
 
+    if (crawl_state.use_des_cache && vault_db_stale)
+        _write_vault_db();
+
     lc_loaded_maps.clear();
 
     {
@@ -1547,7 +2004,9 @@ void reread_maps()
 
     // BOOM!
     vdefs.clear();
+    _invalidate_vault_index();
     map_files_read.clear();
+    des_files_read.clear();
     read_maps();
 }
 
@@ -1594,6 +2053,8 @@ void run_map_local_preludes()
             }
         }
     }
+    // Preludes may have retagged their maps.
+    _invalidate_vault_index();
 }
 
 const map_def *map_by_index(int index)
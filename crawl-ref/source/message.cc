@@ -1362,15 +1362,28 @@ void dprf(diag_type param, const char *format, ...)
 
 static bool _updating_view = false;
 
+static const text_pattern &_filter_pattern(const message_filter &filter)
+{
+    return filter.pattern;
+}
+
+static const text_pattern &_mapping_pattern(const message_colour_mapping &mcm)
+{
+    return mcm.message.pattern;
+}
+
 static bool _check_option(const string& line, msg_channel_type channel,
-                          const vector<message_filter>& option)
+                          const vector<message_filter>& option,
+                          cached_pattern_set &cache)
 {
     if (crawl_state.generating_level)
         return false;
-    return any_of(begin(option),
-                  end(option),
-                  bind(mem_fn(&message_filter::is_filtered),
-                       placeholders::_1, channel, line));
+    const pattern_set &patterns = cache.get(option, Options.generation,
+                                            _filter_pattern);
+    return patterns.first_match(line, [&](int i)
+        {
+            return option[i].is_filtered(channel, line);
+        }) >= 0;
 }
 
 static bool _check_more(const string& line, msg_channel_type channel)
@@ -1380,7 +1393,8 @@ static bool _check_more(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.force_more_message);
+    static cached_pattern_set patterns;
+    return _check_option(line, channel, Options.force_more_message, patterns);
 }
 
 static bool _check_flash_screen(const string& line, msg_channel_type channel)
@@ -1390,7 +1404,9 @@ static bool _check_flash_screen(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.flash_screen_message);
+    static cached_pattern_set patterns;
+    return _check_option(line, channel, Options.flash_screen_message,
+                         patterns);
 }
 
 static bool _check_join(const string& /*line*/, msg_channel_type channel)
@@ -1566,11 +1582,12 @@ static void _mpr(string text, msg_channel_type channel, int param, bool nojoin,
     // TODO: running this hook from here is still pretty crazy, maybe it should
     // be batched and done in the main game loop? But doing it this way at least
     // does let us directly detect recursion.
-    if (!_doing_c_message_hook)
+    static lua_hook c_message_hook("c_message");
+    if (!_doing_c_message_hook && c_message_hook.active(clua))
     {
         unwind_bool no_reentry(_doing_c_message_hook, true);
-        clua.callfn("c_message", "ss", text.c_str(),
-                                        channel_to_str(channel).c_str());
+        c_message_hook.callfn(clua, "ss", text.c_str(),
+                              channel_to_str(channel).c_str());
     }
 
     bool domore = _check_more(text, channel);
@@ -1834,14 +1851,17 @@ static msg_colour_type prepare_message(const string& imsg,
 
     if (!crawl_state.generating_level)
     {
-        for (const message_colour_mapping &mcm : Options.message_colour_mappings)
-        {
-            if (mcm.valid() && mcm.message.is_filtered(channel, imsg))
+        static cached_pattern_set patterns;
+        const auto &mappings = Options.message_colour_mappings;
+        const pattern_set &mapped = patterns.get(mappings, Options.generation,
+                                                 _mapping_pattern);
+        const int i = mapped.first_match(imsg, [&](int j)
             {
-                colour = mcm.colour;
-                break;
-            }
-        }
+                return mappings[j].valid()
+                       && mappings[j].message.is_filtered(channel, imsg);
+            });
+        if (i >= 0)
+            colour = mappings[i].colour;
     }
 
     return colour;
@@ -2372,8 +2372,11 @@ void clear_monster_flags()
     // Clear any summoning flags so that lower indiced
     // monsters get their actions in the next round.
     // Also clear one-turn deep sleep flag.
-    for (auto &mons : menv_real)
-        mons.flags &= ~MF_JUST_SUMMONED & ~MF_JUST_SLEPT;
+    for (int i = env.mons_used.next(0); i < MAX_MONSTERS;
+         i = env.mons_used.next(i + 1))
+    {
+        env.mons[i].flags &= ~MF_JUST_SUMMONED & ~MF_JUST_SLEPT;
+    }
 }
 
 /**
@@ -4606,6 +4606,10 @@ bool handle_mon_spell(monster* mons)
     if (!hspell_pass.size())
         return false;
 
+    // Nothing moves until we cast, so spells which trace the same beam
+    // can share one tracer.
+    tracer_cache tracers;
+
     bolt beem = setup_targeting_beam(*mons);
 
     bool ignore_good_idea = false;
@@ -4688,6 +4692,8 @@ bool handle_mon_spell(monster* mons)
         return false;
     }
 
+    tracers.stop();
+
     // Check for antimagic if casting a spell spell.
     if (mons->has_ench(ENCH_ANTIMAGIC) && flags & MON_SPELL_ANTIMAGIC_MASK
         && !x_chance_in_y(4 * BASELINE_DELAY,
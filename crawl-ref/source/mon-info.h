@@ -333,6 +333,11 @@ struct monster_info : public monster_info_base
         return *this;
     }
 
+    // Moving hands over the strings, props and inventory instead of
+    // copying them, which matters when filling in map knowledge.
+    monster_info(monster_info&& mi) = default;
+    monster_info& operator=(monster_info&& mi) = default;
+
     void to_string(int count, string& desc, int& desc_colour,
                    bool fullname = true, const char *adjective = nullptr,
                    bool verbose = true) const;
@@ -121,8 +121,21 @@ monster &monster::operator = (const monster& mon)
     return *this;
 }
 
+// This monster's index in env.mons, if it's one of the real slots there
+// rather than a copy elsewhere; -1 otherwise.
+static int _mons_slot(const monster *mon)
+{
+    if (mon < &env.mons[0] || mon >= &env.mons[MAX_MONSTERS])
+        return -1;
+    return mon - &env.mons[0];
+}
+
 void monster::reset()
 {
+    const int slot = _mons_slot(this);
+    if (slot != -1)
+        env.mons_used.remove(slot);
+
     mname.clear();
     enchantments.clear();
     ench_cache.reset();
@@ -213,6 +226,10 @@ void monster::init_with(const monster& mon)
         ghost.reset(new ghost_demon(*mon.ghost));
     else
         ghost.reset(nullptr);
+
+    const int slot = _mons_slot(this);
+    if (slot != -1 && type != MONS_NO_MONSTER)
+        env.mons_used.add(slot);
 }
 
 uint32_t monster::last_client_id = 0;
@@ -150,7 +150,8 @@ bool mons_is_safe(const monster* mon, const bool want_move,
                            // monsters capable of throwing or zapping wands.
                            || !mons_can_hurt_player(mon)));
 
-    if (consider_user_options)
+    static lua_hook ch_mon_is_safe("ch_mon_is_safe");
+    if (consider_user_options && ch_mon_is_safe.active(clua))
     {
         bool moving = you_are_delayed()
                        && current_delay()->is_run()
@@ -161,9 +162,9 @@ bool mons_is_safe(const monster* mon, const bool want_move,
         bool result = is_safe;
 
         monster_info mi(mon, MILEV_SKIP_SAFE);
-        if (clua.callfn("ch_mon_is_safe", "Ibbd>b",
-                        &mi, is_safe, moving, dist,
-                        &result))
+        if (ch_mon_is_safe.callfn(clua, "Ibbd>b",
+                                  &mi, is_safe, moving, dist,
+                                  &result))
         {
             is_safe = result;
         }
@@ -338,6 +338,8 @@ struct base_game_options
     string      filename;     // The name of the file containing options.
     string      basefilename; // Base (pathless) file name
     int         line_num;     // Current line number being processed.
+    // Bumped whenever options may have changed, for things cached from them.
+    unsigned int generation;
 
     // Fix option values if necessary, specifically file paths.
     void reset_loaded_state();
@@ -935,6 +937,7 @@ public:
     bool        tile_level_map_hide_sidebar;
     bool        tile_web_mouse_control;
     string      tile_web_mobile_input_helper;
+    bool        tile_web_packed_map;
 #endif
 #endif // USE_TILE
 
@@ -16,6 +16,16 @@ Notes:
 * Readers always get the last complete (but not necessarily committed) write
   (ie, READ_UNCOMMITTED) at the time they started; it is safe to continue
   reading even if the chunk has been changed since.
+
+Delta saves:
+* With set_delta_saves(), writers hand the whole chunk over when closed. If
+  it's the same as the last write, nothing happens. Otherwise it's compared
+  page by page with the last full write of the chunk made in this session,
+  and if few enough pages differ, only those are stored, as a delta next to
+  the chunk's directory entry. Readers put the chunk back together.
+* A rewrite with too many changed pages, compact(), and closing the package
+  all fold the deltas back. A save that has none uses the old directory
+  format, so only saves from an interrupted session need a newer reader.
 */
 
 #include "AppHdr.h"
@@ -32,12 +42,18 @@ Notes:
 #if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
 #include <unistd.h>
 #endif
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "end.h"
 #include "endianness.h"
 #include "errors.h"
 #include "syscalls.h"
 #include "libutil.h" // map_find
+#ifdef USE_DEFLATE_THREADS
+#include "threads.h"
+#endif
 
 // debugging defines
 #undef  FSCK_VERBOSE
@@ -60,6 +76,8 @@ static plen_t htole(plen_t x)
 #endif
 
 #define PACKAGE_VERSION 1
+// the directory also has the start of each chunk's delta
+#define PACKAGE_VERSION_DELTAS 2
 #define PACKAGE_MAGIC   0x53534344 /* "DCSS" */
 
 struct file_header
@@ -81,11 +99,278 @@ typedef pair<plen_t, plen_t> bm_p;
 typedef map<plen_t, bm_p> bm_t;
 typedef map<plen_t, plen_t> fb_t;
 
+#define ZB_SIZE 32768
+
+#ifdef USE_DEFLATE_THREADS
+/*
+Threaded compression:
+
+A chunk is still stored as a single zlib stream, so readers don't care how
+it was written. The input is cut into segments which are deflated
+independently as raw deflate data, each primed with the tail of the previous
+segment as its dictionary and ended with a sync flush, so the pieces can
+simply be concatenated (the same trick pigz uses). The zlib header and the
+combined adler32 trailer are added when the pieces are written out, which
+happens only at commit() or when something needs to look at the chunk.
+*/
+
+#define SEGMENT_SIZE (128 * 1024)
+#define DICT_SIZE    32768
+
+static int deflate_threads = 0;
+
+struct deflate_job
+{
+    vector<Bytef> in;
+    vector<Bytef> dict;
+    bool last;
+    vector<Bytef> out;
+    uLong adler;
+    string error;
+    bool done;
+};
+
+struct pending_chunk
+{
+    string name;
+    vector<unique_ptr<deflate_job> > jobs;
+};
+
+static void _deflate_segment(deflate_job &job)
+{
+    z_stream zs;
+    zs.zalloc = 0;
+    zs.zfree  = 0;
+    zs.opaque = Z_NULL;
+    // Negative window bits: raw deflate, no zlib header or trailer.
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        job.error = zs.msg ? zs.msg : "init failed";
+        return;
+    }
+
+    if (!job.dict.empty()
+        && deflateSetDictionary(&zs, &job.dict[0], job.dict.size()) != Z_OK)
+    {
+        job.error = zs.msg ? zs.msg : "bad dictionary";
+        deflateEnd(&zs);
+        return;
+    }
+
+    job.adler = adler32(adler32(0, Z_NULL, 0), job.in.data(), job.in.size());
+
+    zs.next_in  = job.in.data();
+    zs.avail_in = job.in.size();
+    const plen_t step = max<plen_t>(ZB_SIZE, deflateBound(&zs, job.in.size()));
+    const int flush = job.last ? Z_FINISH : Z_SYNC_FLUSH;
+    int res;
+    do
+    {
+        const size_t have = job.out.size();
+        job.out.resize(have + step);
+        zs.next_out  = &job.out[have];
+        zs.avail_out = step;
+        res = deflate(&zs, flush);
+        job.out.resize(have + step - zs.avail_out);
+        if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR)
+        {
+            job.error = zs.msg ? zs.msg : "deflate failed";
+            break;
+        }
+    } while (job.last ? res != Z_STREAM_END : !zs.avail_out);
+
+    deflateEnd(&zs);
+}
+
+class deflate_pool
+{
+public:
+    deflate_pool(int nthreads);
+    void resize(int nthreads);
+    void submit(deflate_job *job);
+    void wait(deflate_job *job);
+
+private:
+    static void *worker(void *pool);
+    void run();
+
+    mutex_t lock;
+    cond_t queued, finished;
+    deque<deflate_job*> queue;
+    int nthreads; // running
+    int wanted;   // what nthreads is heading for
+};
+
+deflate_pool::deflate_pool(int threads) : nthreads(0), wanted(0)
+{
+    mutex_init(lock);
+    cond_init(queued);
+    cond_init(finished);
+    resize(threads);
+}
+
+// Starts more workers, or asks surplus ones to exit once the queue is empty.
+void deflate_pool::resize(int threads)
+{
+    mutex_lock(lock);
+    while (nthreads < threads)
+    {
+        thread_t th;
+        if (thread_create_detached(&th, worker, this))
+            break;
+        nthreads++;
+    }
+    wanted = min(threads, nthreads);
+    for (int i = wanted; i < nthreads; i++)
+        cond_wake(queued);
+    mutex_unlock(lock);
+    dprintf("deflate_pool: %d of %d threads\n", wanted, threads);
+}
+
+void *deflate_pool::worker(void *pool)
+{
+    static_cast<deflate_pool*>(pool)->run();
+    return nullptr;
+}
+
+void deflate_pool::run()
+{
+    mutex_lock(lock);
+    while (true)
+    {
+        while (queue.empty() && nthreads <= wanted)
+            cond_wait(queued, lock);
+        if (queue.empty())
+        {
+            nthreads--;
+            mutex_unlock(lock);
+            return;
+        }
+        deflate_job *job = queue.front();
+        queue.pop_front();
+        mutex_unlock(lock);
+
+        _deflate_segment(*job);
+
+        mutex_lock(lock);
+        job->done = true;
+        cond_wake(finished);
+    }
+}
+
+void deflate_pool::submit(deflate_job *job)
+{
+    job->done = false;
+    mutex_lock(lock);
+    if (!wanted)
+    {
+        // No threads (or couldn't start any), so just do the work here.
+        mutex_unlock(lock);
+        _deflate_segment(*job);
+        job->done = true;
+        return;
+    }
+
+    queue.push_back(job);
+    cond_wake(queued);
+    mutex_unlock(lock);
+}
+
+void deflate_pool::wait(deflate_job *job)
+{
+    mutex_lock(lock);
+    while (!job->done)
+        cond_wait(finished, lock);
+    mutex_unlock(lock);
+}
+
+// Created on first use, and never freed: the workers just sleep when
+// there's nothing to compress, and die with the process.
+static deflate_pool *deflate_workers = nullptr;
+
+static deflate_pool &_deflate_pool()
+{
+    if (!deflate_workers)
+        deflate_workers = new deflate_pool(deflate_threads);
+    return *deflate_workers;
+}
+#endif
+
+void package::set_compression_threads(int threads)
+{
+#ifdef USE_DEFLATE_THREADS
+    deflate_threads = max(threads, 0);
+    if (deflate_workers)
+        deflate_workers->resize(deflate_threads);
+#else
+    UNUSED(threads);
+#endif
+}
+
+#ifdef USE_MMAP
+static bool use_mmap = false;
+#endif
+
+void package::set_mmap(bool enable)
+{
+#ifdef USE_MMAP
+    use_mmap = enable;
+#else
+    UNUSED(enable);
+#endif
+}
+
+#ifdef USE_DELTA_SAVES
+#define DELTA_PAGE_SIZE  4096
+// Fold the deltas back this often even if they stay small, so a crashed
+// session doesn't leave a save that needs long patching.
+#define COMPACT_INTERVAL 64
+
+static bool use_delta_saves = false;
+
+// The length of the given page of a chunk, 0 if past the end.
+static plen_t _page_len(plen_t len, plen_t page)
+{
+    if (page >= len / DELTA_PAGE_SIZE + (len % DELTA_PAGE_SIZE != 0))
+        return 0;
+    return min<plen_t>(DELTA_PAGE_SIZE, len - page * DELTA_PAGE_SIZE);
+}
+
+static vector<uint64_t> _page_hashes(const unsigned char *data, plen_t len)
+{
+    vector<uint64_t> hashes((len + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE);
+    for (plen_t i = 0; i < hashes.size(); i++)
+    {
+        const Bytef *page = data + i * DELTA_PAGE_SIZE;
+        const plen_t plen = _page_len(len, i);
+        hashes[i] = (uint64_t)crc32(0, page, plen) << 32
+                    | adler32(1, page, plen);
+    }
+    return hashes;
+}
+#endif
+
+void package::set_delta_saves(bool enable)
+{
+#ifdef USE_DELTA_SAVES
+    use_delta_saves = enable;
+#else
+    UNUSED(enable);
+#endif
+}
+
 package::package(const char* file, bool writeable, bool empty)
   : n_users(0), dirty(false), aborted(false)
 #ifdef DO_FSYNC
     , tmp(false)
 #endif
+#ifdef USE_MMAP
+    , mmapped(use_mmap), map_base(nullptr), map_len(0)
+#endif
+#ifdef USE_DELTA_SAVES
+    , track_deltas(use_delta_saves), commits_since_compact(0)
+#endif
 {
     dprintf("package: initializing file=\"%s\" rw=%d\n", file, writeable);
     ASSERT(writeable || !empty);
@@ -125,6 +410,9 @@ package::package(const char* file, bool writeable, bool empty)
         }
         catch (exception &e)
         {
+#ifdef USE_MMAP
+            unmap();
+#endif
             close(fd);
             throw;
         }
@@ -136,6 +424,12 @@ package::package()
 #ifdef DO_FSYNC
     , tmp(true)
 #endif
+#ifdef USE_MMAP
+    , mmapped(use_mmap), map_base(nullptr), map_len(0)
+#endif
+#ifdef USE_DELTA_SAVES
+    , track_deltas(use_delta_saves), commits_since_compact(0)
+#endif
 {
     dprintf("package: initializing tmp file\n");
     filename = "[tmp]";
@@ -197,6 +491,10 @@ void package::load_traces()
 
     for (const auto &entry : directory)
         trace_chunk(entry.second);
+#ifdef USE_DELTA_SAVES
+    for (const auto &entry : deltas)
+        trace_chunk(entry.second);
+#endif
 
 #ifdef COSTLY_ASSERTS
     // any inconsistency in the save is guaranteed to be already found
@@ -216,10 +514,17 @@ package::~package()
 
     if (rw && !aborted)
     {
+        compact();
         commit();
         if (ftruncate(fd, file_len))
             sysfail("failed to update save file");
     }
+#ifdef USE_DEFLATE_THREADS
+    drop_pending();
+#endif
+#ifdef USE_MMAP
+    unmap();
+#endif
 
     // all errors here should be cached write errors
     if (fd != -1)
@@ -234,6 +539,11 @@ package::~package()
 void package::commit()
 {
     ASSERT(rw);
+#ifdef USE_DELTA_SAVES
+    if (!deltas.empty() && ++commits_since_compact >= COMPACT_INTERVAL)
+        compact();
+#endif
+    flush_pending();
     if (!dirty)
         return;
     ASSERT(!aborted);
@@ -244,9 +554,14 @@ void package::commit()
 
     file_header head;
     head.magic = htole(PACKAGE_MAGIC);
-    head.version = PACKAGE_VERSION;
     memset(&head.padding, 0, sizeof(head.padding));
     head.start = htole(write_directory());
+#ifdef USE_DELTA_SAVES
+    // Older versions can't read deltas, so only saves that have any say so.
+    head.version = deltas.empty() ? PACKAGE_VERSION : PACKAGE_VERSION_DELTAS;
+#else
+    head.version = PACKAGE_VERSION;
+#endif
 #ifdef DO_FSYNC
     // We need a barrier before updating the link to point at the new directory.
     if (!tmp && fdatasync(fd))
@@ -269,6 +584,63 @@ void package::commit()
 #endif
 }
 
+// Returns the given range of the file from the memory mapping, or nullptr
+// if this package doesn't use one.
+const char *package::mapped(plen_t at, plen_t len)
+{
+#ifdef USE_MMAP
+    if (!mmapped)
+        return nullptr;
+    ASSERT(!aborted);
+
+    if (at + len > file_len || at + len < at)
+        corrupted("save file corrupted -- block past eof");
+
+    if (at + len > map_len)
+    {
+        // The file has grown since. Readers may still hold pointers into
+        // the old mapping, so it can go away only once they're done.
+        if (map_base)
+            stale_maps.emplace_back(map_base, map_len);
+        map_base = nullptr;
+        map_len = 0;
+
+        void *m = mmap(nullptr, file_len, PROT_READ, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED)
+        {
+            dprintf("package: mmap failed, falling back to read()\n");
+            mmapped = false;
+            return nullptr;
+        }
+        map_base = (const char *)m;
+        map_len = file_len;
+    }
+
+    return map_base + at;
+#else
+    UNUSED(at, len);
+    return nullptr;
+#endif
+}
+
+#ifdef USE_MMAP
+void package::release_stale_maps()
+{
+    for (const auto &m : stale_maps)
+        munmap((void *)m.first, m.second);
+    stale_maps.clear();
+}
+
+void package::unmap()
+{
+    if (map_base)
+        munmap((void *)map_base, map_len);
+    map_base = nullptr;
+    map_len = 0;
+    release_stale_maps();
+}
+#endif
+
 void package::seek(plen_t to)
 {
     ASSERT(!aborted);
@@ -286,8 +658,19 @@ chunk_writer* package::writer(const string &name)
 
 chunk_reader* package::reader(const string &name)
 {
+#ifdef USE_DEFLATE_THREADS
+    if (is_pending(name))
+        flush_pending();
+#endif
     if (plen_t *ch = map_find(directory, name))
-        return new chunk_reader(this, *ch);
+    {
+        unique_ptr<chunk_reader> rd(new chunk_reader(this, *ch));
+#ifdef USE_DELTA_SAVES
+        if (plen_t *delta = map_find(deltas, name))
+            rd->apply_delta(*delta);
+#endif
+        return rd.release();
+    }
     return 0;
 }
 
@@ -374,20 +757,180 @@ void package::free_chunk(const string &name)
         return;
 
     dprintf("freeing chunk(%s)\n", name.c_str());
-    if (new_chunks.count(ci->second))
-        free_block_chain(ci->second);
-    else // can't free committed blocks yet
-        unlinked_blocks.push_back(ci->second);
-
+    free_chain(ci->second);
     dirty = true;
 }
 
+void package::free_chain(plen_t at)
+{
+    if (new_chunks.count(at))
+        free_block_chain(at);
+    else // can't free committed blocks yet
+        unlinked_blocks.push_back(at);
+}
+
 void package::delete_chunk(const string &name)
 {
+#ifdef USE_DEFLATE_THREADS
+    if (is_pending(name))
+        flush_pending();
+#endif
+#ifdef USE_DELTA_SAVES
+    drop_delta(name);
+#endif
     free_chunk(name);
     directory.erase(name);
 }
 
+#ifdef USE_DELTA_SAVES
+void package::finish_delta(const string &name, plen_t at)
+{
+    if (plen_t *old = map_find(deltas, name))
+        free_chain(*old);
+    deltas[name] = at;
+    new_chunks.insert(at);
+    dirty = true;
+}
+
+// Forget the chunk's delta along with what it was taken against; done
+// whenever the chunk gets a full write.
+void package::drop_delta(const string &name)
+{
+    fingerprints.erase(name);
+    auto di = deltas.find(name);
+    if (di == deltas.end())
+        return;
+
+    dprintf("freeing delta(%s)\n", name.c_str());
+    free_chain(di->second);
+    deltas.erase(di);
+    dirty = true;
+}
+
+void package::store_chunk(const string &name, const vector<unsigned char> &data)
+{
+    const plen_t len = data.size();
+    const unsigned char *bytes = data.empty() ? nullptr : &data[0];
+    vector<uint64_t> pages = _page_hashes(bytes, len);
+
+    chunk_fingerprint *fp = map_find(fingerprints, name);
+    if (fp && fp->last_len == len && fp->last == pages)
+    {
+        dprintf("chunk(%s) unchanged, not rewriting\n", name.c_str());
+        return;
+    }
+
+    if (fp)
+    {
+        auto page_changed = [&](plen_t i)
+        {
+            return _page_len(fp->base_len, i) != _page_len(len, i)
+                   || fp->base[i] != pages[i];
+        };
+        plen_t nchanged = 0;
+        for (plen_t i = 0; i < pages.size(); i++)
+            nchanged += page_changed(i);
+
+        // Past half of the chunk, a delta isn't worth the patching.
+        if (nchanged * DELTA_PAGE_SIZE <= len / 2)
+        {
+            // The hashes can only tell a page has changed; compare the
+            // others with the base itself, as a collision would quietly lose
+            // a change.
+            vector<unsigned char> base;
+            read_base(name, base);
+            vector<plen_t> changed;
+            for (plen_t i = 0; i < pages.size(); i++)
+            {
+                if (page_changed(i)
+                    || memcmp(&base[i * DELTA_PAGE_SIZE],
+                              bytes + i * DELTA_PAGE_SIZE, _page_len(len, i)))
+                {
+                    changed.push_back(i);
+                }
+            }
+
+            dprintf("chunk(%s): %u of %u pages changed\n", name.c_str(),
+                    (unsigned int)changed.size(), (unsigned int)pages.size());
+            chunk_writer wr(this, name, chunk_writer::WRITE_DELTA);
+            const plen_t head[2] = { htole(len), htole(fp->base_len) };
+            wr.write(head, sizeof(head));
+            for (plen_t i : changed)
+            {
+                const plen_t page = htole(i);
+                wr.write(&page, sizeof(page));
+                wr.write(bytes + i * DELTA_PAGE_SIZE, _page_len(len, i));
+            }
+            fp->last_len = len;
+            fp->last = move(pages);
+            return;
+        }
+    }
+
+    {
+        chunk_writer wr(this, name, chunk_writer::WRITE_PLAIN);
+        if (len)
+            wr.write(bytes, len);
+    }
+    remember_full_write(name, len, move(pages));
+}
+
+// Later writes of the chunk will be compared against this one.
+void package::remember_full_write(const string &name, plen_t len,
+                                  vector<uint64_t> pages)
+{
+    chunk_fingerprint &fp = fingerprints[name];
+    fp.base_len = fp.last_len = len;
+    fp.last = pages;
+    fp.base = move(pages);
+}
+
+// The chunk's last full write, without its delta.
+void package::read_base(const string &name, vector<unsigned char> &data)
+{
+#ifdef USE_DEFLATE_THREADS
+    if (is_pending(name))
+        flush_pending();
+#endif
+    chunk_reader rd(this, directory[name]);
+    rd.read_all(data);
+    if (data.size() != fingerprints[name].base_len)
+        corrupted("save file corrupted -- chunk \"%s\" changed", name.c_str());
+}
+#endif
+
+void package::compact()
+{
+#ifdef USE_DELTA_SAVES
+    ASSERT(rw);
+    vector<string> names;
+    for (const auto &entry : deltas)
+        names.push_back(entry.first);
+
+    for (const string &name : names)
+    {
+        vector<unsigned char> data;
+        {
+            chunk_reader rd(this, name);
+            rd.read_all(data);
+        }
+        // Closing the writer drops the delta.
+        {
+            chunk_writer wr(this, name, chunk_writer::WRITE_PLAIN);
+            if (!data.empty())
+                wr.write(&data[0], data.size());
+        }
+        if (track_deltas)
+        {
+            remember_full_write(name, data.size(),
+                                _page_hashes(data.empty() ? nullptr : &data[0],
+                                             data.size()));
+        }
+    }
+    commits_since_compact = 0;
+#endif
+}
+
 plen_t package::write_directory()
 {
     delete_chunk("");
@@ -400,6 +943,14 @@ plen_t package::write_directory()
         dir.write(&entry.first[0], entry.first.length());
         plen_t start = htole(entry.second);
         dir.write((const char*)&start, sizeof(plen_t));
+#ifdef USE_DELTA_SAVES
+        if (!deltas.empty())
+        {
+            const plen_t *delta = map_find(deltas, entry.first);
+            plen_t dstart = htole(delta ? *delta : 0);
+            dir.write((const char*)&dstart, sizeof(plen_t));
+        }
+#endif
     }
 
     ASSERT(dir.str().size());
@@ -539,7 +1090,8 @@ void package::read_directory(plen_t start, uint8_t version)
             dprintf("* %s\n", chname.c_str());
         }
         break;
-    case 1:
+    case PACKAGE_VERSION:
+    case PACKAGE_VERSION_DELTAS:
         uint8_t name_len;
         plen_t bstart;
         while (plen_t res = rd.read(&name_len, sizeof(name_len)))
@@ -554,6 +1106,18 @@ void package::read_directory(plen_t start, uint8_t version)
                 corrupted("save file corrupted -- truncated directory");
             directory[chname] = htole(bstart);
             dprintf("* %s\n", chname.c_str());
+            if (version < PACKAGE_VERSION_DELTAS)
+                continue;
+            if (rd.read(&bstart, sizeof(bstart)) != sizeof(bstart))
+                corrupted("save file corrupted -- truncated directory");
+            if (!bstart)
+                continue;
+#ifdef USE_DELTA_SAVES
+            deltas[chname] = htole(bstart);
+#else
+            corrupted("save file (%s) has chunk deltas, not supported by "
+                      "this build", filename.c_str());
+#endif
         }
         break;
     default:
@@ -564,11 +1128,16 @@ void package::read_directory(plen_t start, uint8_t version)
 
 bool package::has_chunk(const string &name)
 {
+#ifdef USE_DEFLATE_THREADS
+    if (is_pending(name))
+        return !name.empty();
+#endif
     return !name.empty() && directory.count(name);
 }
 
 vector<string> package::list_chunks()
 {
+    flush_pending();
     vector<string> list;
     list.reserve(directory.size());
     for (const auto &entry : directory)
@@ -583,12 +1152,17 @@ void package::trace_chunk(plen_t start)
     while (start)
     {
         block_header bl;
-        seek(start);
-        ssize_t res = ::read(fd, &bl, sizeof(block_header));
-        if (res < 0)
-            sysfail("error reading the save file");
-        if (res != sizeof(block_header))
-            corrupted("save file corrupted -- block past eof");
+        if (const char *hd = mapped(start, sizeof(block_header)))
+            memcpy(&bl, hd, sizeof(block_header));
+        else
+        {
+            seek(start);
+            ssize_t res = ::read(fd, &bl, sizeof(block_header));
+            if (res < 0)
+                sysfail("error reading the save file");
+            if (res != sizeof(block_header))
+                corrupted("save file corrupted -- block past eof");
+        }
 
         plen_t len  = htole(bl.len);
         plen_t next = htole(bl.next);
@@ -620,11 +1194,79 @@ void package::abort()
     // this point are ignored (assuming we already failed). All writes since
     // the last commit() are lost.
     aborted = true;
+#ifdef USE_DEFLATE_THREADS
+    drop_pending();
+#endif
+}
+
+#ifdef USE_DEFLATE_THREADS
+bool package::is_pending(const string &name) const
+{
+    for (const auto &ch : pending)
+        if (ch->name == name)
+            return true;
+    return false;
+}
+
+// Forget closed writers without storing them. The workers may still be
+// chewing on their data, though.
+void package::drop_pending()
+{
+    for (const auto &ch : pending)
+        for (const auto &job : ch->jobs)
+            _deflate_pool().wait(job.get());
+    pending.clear();
+}
+#endif
+
+// Store the chunks that are still being deflated, waiting for the
+// outstanding segments as needed.
+void package::flush_pending()
+{
+#ifdef USE_DEFLATE_THREADS
+    if (pending.empty())
+        return;
+    ASSERT(!aborted);
+
+    vector<unique_ptr<pending_chunk> > chunks;
+    chunks.swap(pending);
+    for (const auto &ch : chunks)
+    {
+        // zlib header for deflate with a 32K window, default level
+        const Bytef header[2] = { 0x78, 0x9c };
+        uLong adler = adler32(0, Z_NULL, 0);
+
+        chunk_writer out(this, ch->name, chunk_writer::WRITE_PRECOMPRESSED);
+        out.raw_write(header, sizeof(header));
+        for (const auto &job : ch->jobs)
+        {
+            _deflate_pool().wait(job.get());
+            if (!job->error.empty())
+            {
+                fail("save file compression failed: %s",
+                     job->error.c_str());
+            }
+            out.raw_write(job->out.data(), job->out.size());
+            adler = adler32_combine(adler, job->adler, job->in.size());
+        }
+
+        // the trailer is big-endian
+        const Bytef trailer[4] =
+        {
+            (Bytef)(adler >> 24), (Bytef)(adler >> 16),
+            (Bytef)(adler >> 8), (Bytef)adler
+        };
+        out.raw_write(trailer, sizeof(trailer));
+    }
+#endif
 }
 
 void package::unlink()
 {
     abort();
+#ifdef USE_MMAP
+    unmap();
+#endif
     close(fd);
     fd = -1;
     ::unlink_u(filename.c_str());
@@ -633,6 +1275,7 @@ void package::unlink()
 // the amount of free space not at the end of file
 plen_t package::get_slack()
 {
+    flush_pending();
     load_traces();
 
     plen_t slack = 0;
@@ -641,40 +1284,63 @@ plen_t package::get_slack()
     return slack;
 }
 
-plen_t package::get_chunk_fragmentation(const string &name)
+// The block chains a chunk takes: the chunk itself, and its delta if any.
+vector<plen_t> package::chunk_chains(const string &name)
 {
+    flush_pending();
     load_traces();
     ASSERT(directory.count(name)); // not has_chunk(), "" is valid
+    vector<plen_t> chains(1, directory[name]);
+#ifdef USE_DELTA_SAVES
+    if (plen_t *delta = map_find(deltas, name))
+        chains.push_back(*delta);
+#endif
+    return chains;
+}
+
+plen_t package::get_chunk_fragmentation(const string &name)
+{
     plen_t frags = 0;
-    plen_t at = directory[name];
-    while (at)
-    {
-        auto bl = block_map.find(at);
-        ASSERT(bl != block_map.end());
-        frags ++;
-        at = bl->second.second;
-    }
+    for (plen_t at : chunk_chains(name))
+        while (at)
+        {
+            auto bl = block_map.find(at);
+            ASSERT(bl != block_map.end());
+            frags ++;
+            at = bl->second.second;
+        }
     return frags;
 }
 
 plen_t package::get_chunk_compressed_length(const string &name)
 {
-    load_traces();
-    ASSERT(directory.count(name)); // not has_chunk(), "" is valid
     plen_t len = 0;
-    plen_t at = directory[name];
-    while (at)
-    {
-        auto bl = block_map.find(at);
-        ASSERT(bl != block_map.end());
-        len += bl->second.first;
-        at = bl->second.second;
-    }
+    for (plen_t at : chunk_chains(name))
+        while (at)
+        {
+            auto bl = block_map.find(at);
+            ASSERT(bl != block_map.end());
+            len += bl->second.first;
+            at = bl->second.second;
+        }
     return len;
 }
 
 chunk_writer::chunk_writer(package *parent, const string &_name)
-    : first_block(0), cur_block(0), block_len(0)
+#ifdef USE_DELTA_SAVES
+    : chunk_writer(parent, _name, parent->track_deltas && !_name.empty()
+                                  ? WRITE_TRACKED : WRITE_PLAIN)
+#else
+    : chunk_writer(parent, _name, WRITE_PLAIN)
+#endif
+{
+}
+
+// Precompressed data is stored as-is; this is used to store chunks that
+// were deflated by the worker threads.
+chunk_writer::chunk_writer(package *parent, const string &_name,
+                           write_mode _mode)
+    : mode(_mode), first_block(0), cur_block(0), block_len(0)
 {
     ASSERT(parent);
     ASSERT(!parent->aborted);
@@ -688,6 +1354,20 @@ chunk_writer::chunk_writer(package *parent, const string &_name)
     pkg->n_users++;
     name = _name;
 
+    if (mode == WRITE_PRECOMPRESSED || mode == WRITE_TRACKED)
+        return;
+#ifdef USE_DEFLATE_THREADS
+    // The directory is written by commit() itself, don't bother; deltas
+    // are small.
+    if (deflate_threads > 0 && !name.empty() && mode == WRITE_PLAIN)
+    {
+        pending.reset(new pending_chunk);
+        pending->name = name;
+        segment.reserve(SEGMENT_SIZE);
+        return;
+    }
+#endif
+
 #ifdef USE_ZLIB
     zs.data_type = Z_BINARY;
     zs.zalloc    = 0;
@@ -695,7 +1375,6 @@ chunk_writer::chunk_writer(package *parent, const string &_name)
     zs.opaque    = Z_NULL;
     if (deflateInit(&zs, Z_DEFAULT_COMPRESSION))
         fail("save file compression failed during init: %s", zs.msg);
-#define ZB_SIZE 32768
     zs.next_out  = z_buffer = (Bytef*)malloc(ZB_SIZE);
     zs.avail_out = ZB_SIZE;
 #endif
@@ -707,6 +1386,42 @@ chunk_writer::~chunk_writer()
 
     ASSERT(pkg->n_users > 0);
     pkg->n_users--;
+
+#ifdef USE_DELTA_SAVES
+    if (mode == WRITE_TRACKED)
+    {
+        if (!pkg->aborted)
+            pkg->store_chunk(name, content);
+        return;
+    }
+    if (mode == WRITE_PLAIN && !pkg->aborted)
+        pkg->drop_delta(name);
+#endif
+#ifdef USE_DEFLATE_THREADS
+    if (pending)
+    {
+        if (pkg->aborted)
+        {
+            for (const auto &job : pending->jobs)
+                _deflate_pool().wait(job.get());
+            return;
+        }
+        // The chunk gets stored once its segments are done.
+        submit_segment(true);
+        pkg->pending.push_back(move(pending));
+        return;
+    }
+#endif
+    if (mode == WRITE_PRECOMPRESSED)
+    {
+        if (pkg->aborted)
+            return;
+        if (cur_block)
+            finish_block(0);
+        pkg->finish_chunk(name, first_block);
+        return;
+    }
+
     if (pkg->aborted)
     {
 #ifdef USE_ZLIB
@@ -735,6 +1450,13 @@ chunk_writer::~chunk_writer()
 #endif
     if (cur_block)
         finish_block(0);
+#ifdef USE_DELTA_SAVES
+    if (mode == WRITE_DELTA)
+    {
+        pkg->finish_delta(name, first_block);
+        return;
+    }
+#endif
     pkg->finish_chunk(name, first_block);
 }
 
@@ -777,11 +1499,58 @@ void chunk_writer::finish_block(plen_t next)
     pkg->block_map[cur_block] = bm_p(block_len, next);
 }
 
+#ifdef USE_DEFLATE_THREADS
+void chunk_writer::submit_segment(bool last)
+{
+    unique_ptr<deflate_job> job(new deflate_job);
+    job->last = last;
+    if (!pending->jobs.empty())
+    {
+        // The workers only ever read the input, so this is safe.
+        const vector<Bytef> &prev = pending->jobs.back()->in;
+        const size_t dict_len = min<size_t>(prev.size(), DICT_SIZE);
+        job->dict.assign(prev.end() - dict_len, prev.end());
+    }
+    job->in.swap(segment);
+    if (!last)
+        segment.reserve(SEGMENT_SIZE);
+
+    _deflate_pool().submit(job.get());
+    pending->jobs.push_back(move(job));
+}
+#endif
+
 void chunk_writer::write(const void *data, plen_t len)
 {
     ASSERT(data);
     ASSERT(!pkg->aborted);
 
+#ifdef USE_DEFLATE_THREADS
+    if (pending)
+    {
+        const Bytef *in = (const Bytef*)data;
+        while (len)
+        {
+            const plen_t s = min<plen_t>(len, SEGMENT_SIZE - segment.size());
+            segment.insert(segment.end(), in, in + s);
+            in += s;
+            len -= s;
+            if (segment.size() == SEGMENT_SIZE)
+                submit_segment(false);
+        }
+        return;
+    }
+#endif
+#ifdef USE_DELTA_SAVES
+    if (mode == WRITE_TRACKED)
+    {
+        const unsigned char *in = (const unsigned char*)data;
+        content.insert(content.end(), in, in + len);
+        return;
+    }
+#endif
+    ASSERT(mode != WRITE_PRECOMPRESSED);
+
 #ifdef USE_ZLIB
     zs.next_in  = (Bytef*)data;
     zs.avail_in = len;
@@ -809,6 +1578,10 @@ void chunk_reader::init(plen_t start)
     pkg->reader_count[start]++;
     first_block = next_block = start;
     block_left = 0;
+#ifdef USE_DELTA_SAVES
+    patched = false;
+    patched_off = 0;
+#endif
 
 #ifdef USE_ZLIB
     if (!start)
@@ -838,11 +1611,52 @@ chunk_reader::chunk_reader(package *parent, const string &_name)
     ASSERT(parent);
     if (!parent->has_chunk(_name))
         corrupted("save file corrupted -- chunk \"%s\" missing", _name.c_str());
+#ifdef USE_DEFLATE_THREADS
+    if (parent->is_pending(_name))
+        parent->flush_pending();
+#endif
     dprintf("chunk_reader(%s): starting\n", _name.c_str());
     pkg = parent;
     init(parent->directory[_name]);
+#ifdef USE_DELTA_SAVES
+    if (plen_t *delta = map_find(parent->deltas, _name))
+        apply_delta(*delta);
+#endif
 }
 
+#ifdef USE_DELTA_SAVES
+// Read the whole chunk, patch it up, and serve reads from memory from now on.
+void chunk_reader::apply_delta(plen_t delta)
+{
+    read_all_into(patched_data);
+
+    chunk_reader rd(pkg, delta);
+    plen_t head[2];
+    if (rd.read(head, sizeof(head)) != sizeof(head))
+        corrupted("save file corrupted -- truncated delta");
+    const plen_t len = htole(head[0]);
+    if (htole(head[1]) != patched_data.size())
+        corrupted("save file corrupted -- delta doesn't match its chunk");
+    patched_data.resize(len);
+
+    plen_t page;
+    while (plen_t res = rd.read(&page, sizeof(page)))
+    {
+        if (res != sizeof(page))
+            corrupted("save file corrupted -- truncated delta");
+        page = htole(page);
+        const plen_t plen = _page_len(len, page);
+        if (!plen)
+            corrupted("save file corrupted -- delta past the end of chunk");
+        if (rd.read(&patched_data[page * DELTA_PAGE_SIZE], plen) != plen)
+            corrupted("save file corrupted -- truncated delta");
+    }
+
+    patched = true;
+    patched_off = 0;
+}
+#endif
+
 chunk_reader::~chunk_reader()
 {
     dprintf("chunk_reader: closing\n");
@@ -854,10 +1668,37 @@ chunk_reader::~chunk_reader()
     ASSERT(pkg->reader_count[first_block] > 0);
     if (!--pkg->reader_count[first_block])
         pkg->reader_count.erase(first_block);
+#ifdef USE_MMAP
+    if (pkg->reader_count.empty())
+        pkg->release_stale_maps();
+#endif
     ASSERT(pkg->n_users > 0);
     pkg->n_users--;
 }
 
+void chunk_reader::load_block()
+{
+    block_header bl;
+    if (const char *hd = pkg->mapped(next_block, sizeof(block_header)))
+        memcpy(&bl, hd, sizeof(block_header));
+    else
+    {
+        pkg->seek(next_block);
+        ssize_t res = ::read(pkg->fd, &bl, sizeof(block_header));
+        if (res < 0)
+            sysfail("error reading the save file");
+        if (res != sizeof(block_header))
+            corrupted("save file corrupted -- block past eof");
+    }
+
+    off = next_block + sizeof(block_header);
+    block_left = htole(bl.len);
+    next_block = htole(bl.next);
+    // This reeks of on-disk corruption (zeroed data).
+    if (!block_left)
+        corrupted("save file corrupted -- empty block");
+}
+
 plen_t chunk_reader::raw_read(void *data, plen_t len)
 {
     void *buf = data;
@@ -867,33 +1708,23 @@ plen_t chunk_reader::raw_read(void *data, plen_t len)
         {
             if (!next_block)
                 return (char*)buf - (char*)data;
-
-            block_header bl;
-            pkg->seek(next_block);
-            ssize_t res = ::read(pkg->fd, &bl, sizeof(block_header));
-            if (res < 0)
-                sysfail("error reading the save file");
-            if (res != sizeof(block_header))
-                corrupted("save file corrupted -- block past eof");
-
-            off = next_block + sizeof(block_header);
-            block_left = htole(bl.len);
-            next_block = htole(bl.next);
-            // This reeks of on-disk corruption (zeroed data).
-            if (!block_left)
-                corrupted("save file corrupted -- empty block");
+            load_block();
         }
-        else
-            pkg->seek(off);
 
         plen_t s = len;
         if (s > block_left)
             s = block_left;
-        ssize_t res = ::read(pkg->fd, buf, s);
-        if (res < 0)
-            sysfail("error reading the save file");
-        if ((plen_t)res != s)
-            corrupted("save file corrupted -- block past eof");
+        if (const char *src = pkg->mapped(off, s))
+            memcpy(buf, src, s);
+        else
+        {
+            pkg->seek(off);
+            ssize_t res = ::read(pkg->fd, buf, s);
+            if (res < 0)
+                sysfail("error reading the save file");
+            if ((plen_t)res != s)
+                corrupted("save file corrupted -- block past eof");
+        }
 
         buf = (char*)buf + s;
         off += s;
@@ -904,12 +1735,41 @@ plen_t chunk_reader::raw_read(void *data, plen_t len)
     return (char*)buf - (char*)data;
 }
 
+// Returns the rest of the current block without copying it, if the package
+// is memory mapped. len is 0 at the end of the chunk.
+bool chunk_reader::raw_span(const void *&data, plen_t &len)
+{
+    if (!block_left && next_block)
+        load_block();
+    len = block_left;
+    if (!len)
+        return pkg->mapped(off, 0) != nullptr;
+
+    data = pkg->mapped(off, len);
+    if (!data)
+        return false;
+    off += len;
+    block_left = 0;
+    return true;
+}
+
 plen_t chunk_reader::read(void *data, plen_t len)
 {
     ASSERT(data);
     if (pkg->aborted)
         return 0;
 
+#ifdef USE_DELTA_SAVES
+    if (patched)
+    {
+        len = min<plen_t>(len, patched_data.size() - patched_off);
+        if (len)
+            memcpy(data, &patched_data[patched_off], len);
+        patched_off += len;
+        return len;
+    }
+#endif
+
 #ifdef USE_ZLIB
     if (!len)
         return 0;
@@ -922,8 +1782,18 @@ plen_t chunk_reader::read(void *data, plen_t len)
     {
         if (!zs.avail_in)
         {
-            zs.next_in  = z_buffer;
-            zs.avail_in = raw_read(z_buffer, sizeof(z_buffer));
+            const void *span;
+            plen_t span_len;
+            if (raw_span(span, span_len))
+            {
+                zs.next_in  = (Bytef*)span;
+                zs.avail_in = span_len;
+            }
+            else
+            {
+                zs.next_in  = z_buffer;
+                zs.avail_in = raw_read(z_buffer, sizeof(z_buffer));
+            }
             if (!zs.avail_in)
                 corrupted("save file corrupted -- block truncated");
         }
@@ -942,16 +1812,27 @@ plen_t chunk_reader::read(void *data, plen_t len)
 #endif
 }
 
-void chunk_reader::read_all(vector<char> &data)
+template<typename T>
+void chunk_reader::read_all_into(vector<T> &data)
 {
-#define SPACE 1024
-    plen_t s, at;
+    plen_t s, at, space;
     do
     {
         at = data.size();
-        data.resize(at + SPACE);
-        s = read(&data[at], SPACE);
-    } while (s == SPACE);
+        // grow geometrically, chunks can be big
+        space = max<plen_t>(at, 1024);
+        data.resize(at + space);
+        s = read(&data[at], space);
+    } while (s == space);
     data.resize(at + s);
-#undef SPACE
+}
+
+void chunk_reader::read_all(vector<char> &data)
+{
+    read_all_into(data);
+}
+
+void chunk_reader::read_all(vector<unsigned char> &data)
+{
+    read_all_into(data);
 }
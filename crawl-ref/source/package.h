@@ -3,6 +3,7 @@
 #define USE_ZLIB
 
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -14,23 +15,57 @@ using std::map;
 using std::pair;
 using std::set;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 #if !defined(DGAMELAUNCH) && !defined(DEBUG_DIAGNOSTICS)
 #define DO_FSYNC
 #endif
 
+// Allow deflating chunks on a pool of worker threads, see
+// package::set_compression_threads().
+#if defined(USE_ZLIB) && !defined(TARGET_OS_WINDOWS)
+#define USE_DEFLATE_THREADS
+#endif
+
+// Allow reading chunks straight from a memory mapping of the save, see
+// package::set_mmap().
+#ifdef UNIX
+#define USE_MMAP
+#endif
+
+// Allow storing rewritten chunks as a delta against their previous version,
+// see package::set_delta_saves().
+#ifdef USE_ZLIB
+#define USE_DELTA_SAVES
+#endif
+
 #define MAX_CHUNK_NAME_LENGTH 255
 
 typedef uint32_t plen_t;
 
 class package;
+#ifdef USE_DEFLATE_THREADS
+struct pending_chunk;
+#endif
 
 class chunk_writer
 {
 private:
+    enum write_mode
+    {
+        WRITE_PLAIN,
+        // collect the data, then let the package pick a full or delta write
+        WRITE_TRACKED,
+        // the delta of a tracked chunk
+        WRITE_DELTA,
+        // data deflated elsewhere, stored as-is
+        WRITE_PRECOMPRESSED,
+    };
+
     package *pkg;
     string name;
+    write_mode mode;
     plen_t first_block;
     plen_t cur_block;
     plen_t block_len;
@@ -38,6 +73,15 @@ private:
     z_stream zs;
     Bytef *z_buffer;
 #endif
+#ifdef USE_DEFLATE_THREADS
+    unique_ptr<pending_chunk> pending;
+    vector<Bytef> segment;
+    void submit_segment(bool last);
+#endif
+#ifdef USE_DELTA_SAVES
+    vector<unsigned char> content;
+#endif
+    chunk_writer(package *parent, const string &_name, write_mode _mode);
     void raw_write(const void *data, plen_t len);
     void finish_block(plen_t next);
 public:
@@ -60,12 +104,23 @@ private:
     z_stream zs;
     Bytef z_buffer[32768];
 #endif
+#ifdef USE_DELTA_SAVES
+    // a chunk with a delta is put together in memory and read from here
+    bool patched;
+    vector<unsigned char> patched_data;
+    plen_t patched_off;
+    void apply_delta(plen_t delta);
+#endif
+    void load_block();
     plen_t raw_read(void *data, plen_t len);
+    bool raw_span(const void *&data, plen_t &len);
+    template<typename T> void read_all_into(vector<T> &data);
 public:
     chunk_reader(package *parent, const string &_name);
     ~chunk_reader();
     plen_t read(void *data, plen_t len);
     void read_all(vector<char> &data);
+    void read_all(vector<unsigned char> &data);
     friend class package;
 };
 
@@ -85,6 +140,20 @@ public:
     void unlink();
     string get_filename() { return filename; }
 
+    // Number of threads used to deflate chunks; 0 means compressing on the
+    // calling thread. Applies to chunks written afterwards.
+    static void set_compression_threads(int threads);
+    // Read chunks through a memory mapping of the file rather than read().
+    // Affects only packages opened afterwards.
+    static void set_mmap(bool enable);
+    // Skip rewriting chunks that haven't changed, and store chunks that
+    // changed only in part as a delta against their last full write.
+    // Affects only packages opened afterwards.
+    static void set_delta_saves(bool enable);
+
+    // Fold all deltas back into their chunks.
+    void compact();
+
     // statistics
     plen_t get_slack();
     plen_t get_size() const { return file_len; };
@@ -107,6 +176,49 @@ private:
     map<plen_t, pair<plen_t, plen_t> > block_map;
     set<plen_t> new_chunks;
     map<plen_t, uint32_t> reader_count;
+#ifdef USE_MMAP
+    bool mmapped;
+    const char *map_base;
+    plen_t map_len;
+    // older mappings that readers may still be pointing into
+    vector<pair<const char*, plen_t> > stale_maps;
+    void release_stale_maps();
+    void unmap();
+#endif
+    const char *mapped(plen_t at, plen_t len);
+#ifdef USE_DELTA_SAVES
+    // Hashes of each DELTA_PAGE_SIZE page of a chunk's content.
+    struct chunk_fingerprint
+    {
+        // the last content written, to spot rewrites that change nothing
+        plen_t last_len;
+        vector<uint64_t> last;
+        // the full write the delta is against; its data is read back from
+        // the package when a delta is made
+        plen_t base_len;
+        vector<uint64_t> base;
+    };
+    bool track_deltas;
+    int commits_since_compact;
+    // chunk name -> start of its delta
+    map<string, plen_t> deltas;
+    map<string, chunk_fingerprint> fingerprints;
+    void store_chunk(const string &name, const vector<unsigned char> &data);
+    void remember_full_write(const string &name, plen_t len,
+                             vector<uint64_t> pages);
+    void read_base(const string &name, vector<unsigned char> &data);
+    void finish_delta(const string &name, plen_t at);
+    void drop_delta(const string &name);
+#endif
+    void free_chain(plen_t at);
+    vector<plen_t> chunk_chains(const string &name);
+#ifdef USE_DEFLATE_THREADS
+    // closed writers whose data is still being deflated
+    vector<unique_ptr<pending_chunk> > pending;
+    bool is_pending(const string &name) const;
+    void drop_pending();
+#endif
+    void flush_pending();
     plen_t extend_block(plen_t at, plen_t size, plen_t by);
     plen_t alloc_block(plen_t &size);
     void finish_chunk(const string &name, plen_t at);
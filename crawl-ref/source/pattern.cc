@@ -229,3 +229,341 @@ pattern_match plaintext_pattern::match_location(const string &s) const
     else
         return pattern_match::failed(s);
 }
+
+// Only ASCII is folded, by both text_pattern literals and the strings they're
+// searched for in, so a literal found this way is found however it's cased.
+// Whether \c is all of an escape: escaped punctuation, or a letter standing
+// for a class or an assertion on its own.
+static bool _is_short_escape(unsigned char c)
+{
+    return c && c < 0x80
+           && (ispunct(c) || strchr("dDsSwWbBAzZGntrfeahHvVRXK", c));
+}
+
+static unsigned char _fold(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/**
+ * Find text that every match of a regex must contain.
+ *
+ * This only understands as much of PCRE and POSIX extended syntax as it needs
+ * to stay on the safe side: anything inside groups or brackets is skipped, and
+ * patterns with alternation, PCRE's (?...) and \Q extensions, or any escape
+ * that could run on past the escaped character (\x41, \101, \p{L}, \g1,
+ * ...) have no required literal at all.
+ *
+ * @param pattern The regex.
+ * @param icase   Whether the regex ignores case. If so, non-ASCII characters
+ *                aren't used, since the regex library may fold them.
+ * @return The longest required run of text, case-folded; or "" if none.
+ */
+string pattern_required_literal(const string &pattern, bool icase)
+{
+    if (pattern.find('|') != string::npos
+        || pattern.find("(?") != string::npos
+        || pattern.find("\\Q") != string::npos
+        || pattern.find("[:") != string::npos
+        || pattern.find("[=") != string::npos
+        || pattern.find("[.") != string::npos)
+    {
+        return "";
+    }
+
+    string best, run;
+    auto end_run = [&best, &run]()
+    {
+        if (run.length() > best.length())
+            best = run;
+        run.clear();
+    };
+
+    // The last character is optional. Drop all of a multibyte one.
+    auto drop_last = [&run]()
+    {
+        if (!run.empty() && static_cast<unsigned char>(run.back()) >= 0x80)
+        {
+            while (!run.empty()
+                   && static_cast<unsigned char>(run.back()) >= 0x80)
+            {
+                run.pop_back();
+            }
+        }
+        else if (!run.empty())
+            run.pop_back();
+    };
+
+    int depth = 0;
+    const size_t len = pattern.length();
+    for (size_t i = 0; i < len; ++i)
+    {
+        const unsigned char c = pattern[i];
+        switch (c)
+        {
+        case '\\':
+            end_run();
+            // Whatever is escaped might not be literal (\d, \b, ...), and
+            // longer escapes aren't worth picking apart.
+            if (++i < len && !_is_short_escape(pattern[i]))
+                return "";
+            break;
+        case '(':
+            end_run();
+            ++depth;
+            break;
+        case ')':
+            end_run();
+            --depth;
+            break;
+        case '[':
+            end_run();
+            ++i;
+            if (i < len && pattern[i] == '^')
+                ++i;
+            if (i < len && pattern[i] == ']')
+                ++i;
+            for (; i < len && pattern[i] != ']'; ++i)
+                if (pattern[i] == '\\')
+                    ++i;
+            break;
+        case '+':
+        {
+            // Still required, unless this is something like b+* in POSIX.
+            size_t j = i + 1;
+            while (j < len && pattern[j] == '+')
+                ++j;
+            if (j < len && strchr("*?{", pattern[j]))
+                drop_last();
+            end_run();
+            break;
+        }
+        case '*':
+        case '?':
+        case '{':
+            drop_last();
+            end_run();
+            if (c == '{')
+                while (i < len && pattern[i] != '}')
+                    ++i;
+            break;
+        case '.':
+        case '^':
+        case '$':
+            end_run();
+            break;
+        default:
+            if (depth != 0 || (icase && c >= 0x80))
+                end_run();
+            else
+                run += _fold(c);
+            break;
+        }
+    }
+    end_run();
+    return best;
+}
+
+string text_pattern::required_literal() const
+{
+    return pattern_required_literal(pattern, ignore_case);
+}
+
+string plaintext_pattern::required_literal() const
+{
+    // All of the pattern, unless case folding might reach beyond ASCII; then
+    // the longest ASCII part of it.
+    string best, run;
+    for (char ch : pattern)
+    {
+        const unsigned char c = ch;
+        if (ignore_case && c >= 0x80)
+        {
+            if (run.length() > best.length())
+                best = run;
+            run.clear();
+        }
+        else
+            run += _fold(c);
+    }
+    return run.length() > best.length() ? run : best;
+}
+
+static uint32_t _trigram(const string &s, size_t i)
+{
+    return _fold(s[i]) | _fold(s[i + 1]) << 8 | _fold(s[i + 2]) << 16;
+}
+
+void literal_index::clear()
+{
+    postings.clear();
+    count = 0;
+}
+
+void literal_index::add(const string &s)
+{
+    const int id = count++;
+    for (size_t i = 0; i + 2 < s.length(); ++i)
+    {
+        vector<int> &ids = postings[_trigram(s, i)];
+        if (ids.empty() || ids.back() != id)
+            ids.push_back(id);
+    }
+}
+
+void literal_index::candidates(const string &literal,
+                               vector<bool> &maybe) const
+{
+    if (literal.length() < 3)
+    {
+        maybe.assign(count, true);
+        return;
+    }
+
+    maybe.assign(count, false);
+    vector<const vector<int> *> lists;
+    for (size_t i = 0; i + 2 < literal.length(); ++i)
+    {
+        auto it = postings.find(_trigram(literal, i));
+        if (it == postings.end())
+            return;
+        lists.push_back(&it->second);
+    }
+    sort(lists.begin(), lists.end(),
+         [](const vector<int> *a, const vector<int> *b)
+         { return a->size() < b->size(); });
+
+    // Every list is in ascending order, so go through the shortest and look
+    // for its ids in the others.
+    for (int id : *lists[0])
+    {
+        bool all = true;
+        for (size_t j = 1; j < lists.size() && all; ++j)
+            all = binary_search(lists[j]->begin(), lists[j]->end(), id);
+        if (all)
+            maybe[id] = true;
+    }
+}
+
+pattern_set::pattern_set()
+    : built(false)
+{
+}
+
+void pattern_set::clear()
+{
+    patterns.clear();
+    literals.clear();
+    trie.clear();
+    built = false;
+}
+
+void pattern_set::add(const text_pattern &pattern)
+{
+    patterns.push_back(pattern);
+    literals.push_back(pattern_required_literal(pattern.tostring(),
+                                                pattern.ignores_case()));
+    built = false;
+}
+
+int pattern_set::child(int n, unsigned char c) const
+{
+    for (const auto &edge : trie[n].next)
+        if (edge.first == c)
+            return edge.second;
+    return -1;
+}
+
+// Build an Aho-Corasick automaton over the literals.
+void pattern_set::build() const
+{
+    trie.assign(1, node());
+    trie[0].fail = 0;
+    trie[0].dict = -1;
+
+    for (int i = 0, size = literals.size(); i < size; ++i)
+    {
+        int n = 0;
+        for (char ch : literals[i])
+        {
+            const unsigned char c = ch;
+            int m = child(n, c);
+            if (m < 0)
+            {
+                m = trie.size();
+                trie.emplace_back();
+                trie[m].fail = 0;
+                trie[m].dict = -1;
+                trie[n].next.emplace_back(c, m);
+            }
+            n = m;
+        }
+        if (n)
+            trie[n].ends.push_back(i);
+    }
+
+    // Breadth first, so fail links always point at finished nodes.
+    vector<int> queue(1, 0);
+    for (size_t q = 0; q < queue.size(); ++q)
+    {
+        const int n = queue[q];
+        for (const auto &edge : trie[n].next)
+        {
+            const int m = edge.second;
+            int f = trie[n].fail;
+            while (f && child(f, edge.first) < 0)
+                f = trie[f].fail;
+            const int fc = child(f, edge.first);
+            trie[m].fail = fc >= 0 && fc != m ? fc : 0;
+
+            const node &fail = trie[trie[m].fail];
+            trie[m].dict = fail.ends.empty() ? fail.dict : trie[m].fail;
+            queue.push_back(m);
+        }
+    }
+
+    built = true;
+}
+
+void pattern_set::candidates(const string &s, vector<bool> &maybe) const
+{
+    if (!built)
+        build();
+
+    maybe.assign(patterns.size(), false);
+    for (int i = 0, size = literals.size(); i < size; ++i)
+        if (literals[i].empty())
+            maybe[i] = true;
+
+    if (trie.size() == 1)
+        return;
+
+    int n = 0;
+    for (char ch : s)
+    {
+        const unsigned char c = _fold(ch);
+        int m;
+        while ((m = child(n, c)) < 0 && n)
+            n = trie[n].fail;
+        n = max(m, 0);
+
+        for (int d = trie[n].ends.empty() ? trie[n].dict : n; d > 0;
+             d = trie[d].dict)
+        {
+            for (int i : trie[d].ends)
+                maybe[i] = true;
+        }
+    }
+}
+
+vector<int> pattern_set::matches(const string &s) const
+{
+    vector<bool> maybe;
+    candidates(s, maybe);
+
+    vector<int> found;
+    for (int i = 0, size = patterns.size(); i < size; ++i)
+        if (maybe[i] && patterns[i].matches(s))
+            found.push_back(i);
+    return found;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <unordered_map>
+
 class pattern_match
 {
 public:
@@ -47,6 +49,9 @@ public:
     virtual bool matches(const string &s) const = 0;
     virtual pattern_match match_location(const string &s) const = 0;
     virtual const string &tostring() const = 0;
+    // Text (ASCII case-folded) that every string this matches contains, or
+    // "" if there's nothing to go on.
+    virtual string required_literal() const { return ""; }
 };
 
 class text_pattern : public base_pattern
@@ -80,6 +85,7 @@ public:
     bool compile() const;
 
     bool empty() const { return !pattern.length(); }
+    bool ignores_case() const { return ignore_case; }
 
     bool valid() const override
     {
@@ -116,6 +122,8 @@ public:
         return pattern;
     }
 
+    string required_literal() const override;
+
 private:
     string pattern;
     mutable void *compiled_pattern;
@@ -150,7 +158,119 @@ public:
         return pattern;
     }
 
+    string required_literal() const override;
+
 private:
     string pattern;
     bool ignore_case;
 };
+
+// A list of text_patterns that can be tested against a string together.
+// Most patterns in an rc file require some literal text, so the literals of
+// every pattern are found in a single pass over the string, and only patterns
+// whose literal turned up (or that have none) are run as regexes. Indices are
+// in the order the patterns were added.
+class pattern_set
+{
+public:
+    pattern_set();
+
+    void clear();
+    void add(const text_pattern &pattern);
+    size_t size() const { return patterns.size(); }
+    bool empty() const { return patterns.empty(); }
+
+    // All patterns matching s, in ascending order.
+    vector<int> matches(const string &s) const;
+
+    int first_match(const string &s) const
+    {
+        return first_match(s, [this, &s](int i)
+                               { return patterns[i].matches(s); });
+    }
+
+    // The first pattern for which confirm(i) holds, only asking about those
+    // that may match s. Lets callers with extra conditions on a pattern
+    // (like message_filter's channels) use their own check.
+    template<class F> int first_match(const string &s, F confirm) const
+    {
+        vector<bool> maybe;
+        candidates(s, maybe);
+        for (int i = 0, size = patterns.size(); i < size; ++i)
+            if (maybe[i] && confirm(i))
+                return i;
+        return -1;
+    }
+
+    // Sets maybe[i] for every pattern that could match s. Exposed for tests.
+    void candidates(const string &s, vector<bool> &maybe) const;
+
+private:
+    struct node
+    {
+        vector<pair<unsigned char, int>> next;
+        int fail;
+        int dict;          // nearest node down the fail chain with ends
+        vector<int> ends;  // patterns whose literal ends here
+    };
+
+    int child(int n, unsigned char c) const;
+    void build() const;
+
+    vector<text_pattern> patterns;
+    vector<string> literals;         // "" if a pattern requires none
+    mutable vector<node> trie;
+    mutable bool built;
+};
+
+string pattern_required_literal(const string &pattern, bool icase);
+
+// Which of a list of strings contain which runs of three characters, for
+// finding the few that may contain some literal text without looking through
+// them all. Strings are ASCII case-folded, like required literals.
+class literal_index
+{
+public:
+    literal_index() : count(0) { }
+
+    void clear();
+    // Index s as the next string; strings are numbered from 0 as added.
+    void add(const string &s);
+    int size() const { return count; }
+
+    // Sets maybe[i] for every string that may contain literal. A literal
+    // shorter than three characters doesn't narrow anything down.
+    void candidates(const string &literal, vector<bool> &maybe) const;
+
+private:
+    unordered_map<uint32_t, vector<int>> postings;
+    int count;
+};
+
+// A pattern_set for a list of things with patterns (usually an option),
+// rebuilt only when the list or its generation changes.
+class cached_pattern_set
+{
+public:
+    cached_pattern_set() : source(nullptr), generation(0) { }
+
+    template<class T, class F>
+    const pattern_set &get(const vector<T> &list, unsigned int gen,
+                           F pattern_of)
+    {
+        if (source != &list || generation != gen)
+        {
+            patterns.clear();
+            for (const T &entry : list)
+                patterns.add(pattern_of(entry));
+            source = &list;
+            generation = gen;
+        }
+        return patterns;
+    }
+
+private:
+    const void *source;
+    unsigned int generation;
+    pattern_set patterns;
+};
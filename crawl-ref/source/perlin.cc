@@ -447,4 +447,56 @@ namespace perlin
         }
         return value / norm;
     }
+
+    // After its first octave, fBM() samples at points that depend only on y
+    // and z: the rotation makes the next x from y. So points sharing y and z,
+    // like those along a row of the map, share the noise of every octave
+    // but the first. Adding the octaves up in the same order keeps each
+    // result exactly what fBM() gives.
+    void fBM(const double *x, const double *y, double z, uint32_t octaves,
+             int n, double *out)
+    {
+        if (octaves <= 1)
+        {
+            for (int i = 0; i < n; ++i)
+                out[i] = fBM(x[i], y[i], z, octaves);
+            return;
+        }
+
+        vector<double> later(octaves);
+        double norm = 0.0;
+        for (int i = 0; i < n; ++i)
+        {
+            if (i == 0 || y[i] != y[i - 1])
+            {
+                uint32_t divisor = 1;
+                double xi = 0.0;
+                double yi = y[i];
+                double zi = z;
+                norm = 0.0;
+                for (uint32_t octave = 0; octave < octaves; ++octave)
+                {
+                    if (octave > 0)
+                    {
+                        later[octave] = noise(xi / divisor, yi / divisor,
+                                              zi / divisor) / divisor;
+                    }
+                    norm += 1 / divisor;
+                    divisor *= 2;
+                    double xt = yi * sin(1.41421356) + cos(1.41421356);
+                    yi = yi * cos(1.41421356) + sin(1.41421356);
+                    xi = xt;
+                    zi += 1.7;
+                }
+            }
+
+            const uint32_t divisor = 1;
+            double value = 0;
+            value += noise(x[i] / divisor, y[i] / divisor, z / divisor)
+                     / divisor;
+            for (uint32_t octave = 1; octave < octaves; ++octave)
+                value += later[octave];
+            out[i] = value / norm;
+        }
+    }
 }
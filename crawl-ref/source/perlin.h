@@ -6,4 +6,8 @@ namespace perlin
     double noise(double xin, double yin, double zin) IMMUTABLE; // Praise Zin!
     double noise(double xin, double yin, double zin, double win) IMMUTABLE;
     double fBM(double xin, double yin, double zin, uint32_t octaves) IMMUTABLE;
+    // fBM(x[i], y[i], z, octaves) for each i < n; quicker when runs of
+    // points share y.
+    void fBM(const double *x, const double *y, double z, uint32_t octaves,
+             int n, double *out);
 }
@@ -1449,7 +1449,7 @@ void shop()
     ShopMenu menu(shop, level_pos::current(), true);
     menu.show();
 
-    StashTrack.get_shop(shop.pos) = ShopInfo(shop);
+    StashTrack.get_shop(shop.pos).update(shop);
     bool any_on_list = any_of(begin(shop.stock), end(shop.stock),
                               [](const item_def& item)
                               {
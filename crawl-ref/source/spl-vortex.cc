@@ -219,9 +219,8 @@ static int _rdam(int rage)
 
 static int _vortex_age(const actor *caster)
 {
-    const string name = POLAR_VORTEX_KEY;
-    if (caster->props.exists(name.c_str()))
-        return you.elapsed_time - caster->props[name.c_str()].get_int();
+    if (caster->props.exists(POLAR_VORTEX_KEY))
+        return you.elapsed_time - caster->props[POLAR_VORTEX_KEY].get_int();
     return 100; // for permanent vortices
 }
 
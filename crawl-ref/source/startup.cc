@@ -79,11 +79,62 @@ static void _loading_message(string m)
 #endif
 }
 
+// Set by startup_preload(), for the first game started afterwards.
+static bool _preloaded = false;
+// Where the preloaded data came from and was cached.
+static string _preload_dirs;
+
+static string _data_dirs()
+{
+    return SysEnv.crawl_dir + "\n" + Options.save_dir;
+}
+
+static void _init_indices()
+{
+    init_spell_descs();        // This needs to be way up top. {dlb}
+    init_zap_index();
+    init_mut_index();
+    init_sac_index();
+    init_duration_index();
+    init_mon_name_cache();
+    init_mons_spells();
+}
+
+/**
+ * Do the slow parts of _initialize() that don't depend on the player's
+ * options ahead of time, so that the next game can skip them. Used by the
+ * zygote, which then forks each game from the loaded state.
+ */
+void startup_preload()
+{
+    _init_indices();
+    init_dungeon_lua();
+
+    // Build any stale databases, but leave each game to open them: forks
+    // of one dbm handle would share its file offset.
+    databaseSystemInit();
+    databaseSystemShutdown();
+
+    read_maps();
+    run_map_global_preludes();
+
+    _preload_dirs = _data_dirs();
+    _preloaded = true;
+}
+
 // Initialise a whole lot of stuff...
 static void _initialize()
 {
     Options.fixup_options();
 
+    // Restarts reload everything, as they always have. So does a game whose
+    // options found its data or cache somewhere other than the preload did,
+    // since the preload ran before any rc file was read.
+    const bool preloaded = _preloaded && _data_dirs() == _preload_dirs;
+    if (_preloaded && !preloaded)
+        dprf("Data directories changed since preloading; reloading.");
+    _preloaded = false;
+
     you.symbol = MONS_PLAYER;
     msg::initialise_mpr_streams();
 
@@ -94,13 +145,8 @@ static void _initialize()
     init_char_table(Options.char_set);
     init_show_table();
     init_monster_symbols();
-    init_spell_descs();        // This needs to be way up top. {dlb}
-    init_zap_index();
-    init_mut_index();
-    init_sac_index();
-    init_duration_index();
-    init_mon_name_cache();
-    init_mons_spells();
+    if (!preloaded)
+        _init_indices();
 
     // init_item_name_cache() needs to be redone after init_char_table()
     // and init_show_table() have been called, so that the glyphs will
@@ -125,7 +171,8 @@ static void _initialize()
     you.unique_items.init(UNIQ_NOT_EXISTS);
 
     // Set up the Lua interpreter for the dungeon builder.
-    init_dungeon_lua();
+    if (!preloaded)
+        init_dungeon_lua();
 
 #ifdef USE_TILE_LOCAL
     // Draw the splash screen before the database gets initialised as that
@@ -146,9 +193,12 @@ static void _initialize()
 #endif
 
     // Read special levels and vaults.
-    _loading_message("Loading maps...");
-    read_maps();
-    run_map_global_preludes();
+    if (!preloaded)
+    {
+        _loading_message("Loading maps...");
+        read_maps();
+        run_map_global_preludes();
+    }
 
     if (crawl_state.build_db)
         end(0);
@@ -277,6 +327,7 @@ static void _post_init(bool newc)
     crawl_state.need_save = crawl_state.game_started = true;
     crawl_state.last_type = crawl_state.type;
     crawl_state.marked_as_won = false;
+    reset_background_pregen();
 
     destroy_abyss();
 
@@ -6,4 +6,5 @@
 #pragma once
 
 bool startup_step();
+void startup_preload();
 void cio_init();
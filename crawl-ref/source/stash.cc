@@ -168,7 +168,8 @@ static void _fully_identify_item(item_def *item)
 // Stash
 // ----------------------------------------------------------------------
 
-Stash::Stash(coord_def pos_) : items()
+Stash::Stash(coord_def pos_) : items(), search_text_stale(true),
+                                search_text_generation(0)
 {
     // First, fix what square we're interested in
     if (pos_.origin())
@@ -263,6 +264,7 @@ void Stash::update()
 
     // Zap existing items
     items.clear();
+    search_text_stale = true;
 
     if (!_grid_has_perceived_item(pos))
     {
@@ -359,25 +361,52 @@ string Stash::feature_description() const
     return feat_desc;
 }
 
+static string _item_search_text(const item_def &item)
+{
+    const string s   = Stash::stash_item_name(item);
+    const string ann = stash_annotate_item(STASH_LUA_SEARCH_ANNOTATE, &item);
+    string text = ann + " " + s;
+    if (is_dumpable_artefact(item))
+        text += " " + chardump_desc(item);
+    return text;
+}
+
+// Redo the search text if the items, or what's known about them, have
+// changed since it was worked out. Returns whether it was redone.
+bool Stash::_update_search_text() const
+{
+    const unsigned int generation = StashTrack.get_search_generation();
+    if (!search_text_stale && search_text_generation == generation)
+        return false;
+
+    search_text.clear();
+    for (const item_def &item : items)
+        search_text.push_back(_item_search_text(item));
+    search_text_stale = false;
+    search_text_generation = generation;
+    return true;
+}
+
 vector<stash_search_result> Stash::matches_search(
-    const string &prefix, const base_pattern &search) const
+    const string &prefix, const base_pattern &search,
+    const vector<bool> *maybe, int first) const
 {
     vector<stash_search_result> results;
     if (empty())
         return results;
 
-    for (const item_def &item : items)
+    _update_search_text();
+    for (size_t i = 0; i < items.size(); ++i)
     {
-        const string s   = stash_item_name(item);
-        const string ann = stash_annotate_item(STASH_LUA_SEARCH_ANNOTATE, &item);
-        string haystack = prefix + " " + ann + " " + s;
-        if (is_dumpable_artefact(item))
-            haystack += " " + chardump_desc(item);
-        if (search.matches(haystack))
+        if (maybe && !(*maybe)[first + i])
+            continue;
+
+        const item_def &item = items[i];
+        if (search.matches(prefix + " " + search_text[i]))
         {
             stash_search_result res;
             res.match_type = MATCH_ITEM;
-            res.match = s;
+            res.match = stash_item_name(item);
             res.primary_sort = item.name(DESC_QUALNAME);
             res.item = item;
             results.push_back(res);
@@ -419,8 +448,12 @@ void Stash::_update_corpses(int rot_time)
         if (new_rot <= 0 && !mons_skeleton(item.mon_type))
         {
             items.erase(items.begin() + i);
+            search_text_stale = true;
             continue;
         }
+        // Skeletons get renamed.
+        if (new_rot <= 0)
+            search_text_stale = true;
         item.stash_freshness = static_cast<short>(new_rot);
     }
 }
@@ -429,8 +462,11 @@ void Stash::_update_identification()
 {
     for (int i = items.size() - 1; i >= 0; i--)
     {
+        const iflags_t flags = items[i].flags;
         god_id_item(items[i]);
         maybe_identify_base_type(items[i]);
+        if (items[i].flags != flags)
+            search_text_stale = true;
     }
 }
 
@@ -443,6 +479,7 @@ void Stash::add_item(item_def &item, bool add_to_front)
         items.insert(items.begin(), item);
     else
         items.push_back(item);
+    search_text_stale = true;
 
     seen_item(item);
 
@@ -547,6 +584,7 @@ void Stash::load(reader& inf)
 
     // Zap out item vector, in case it's in use (however unlikely)
     items.clear();
+    search_text_stale = true;
     // Read in the items
     for (int i = 0; i < count; ++i)
     {
@@ -558,10 +596,23 @@ void Stash::load(reader& inf)
 }
 
 ShopInfo::ShopInfo(const shop_struct& shop_)
-    : shop(shop_)
+    : shop(shop_), search_text_generation(0)
 {
 }
 
+void ShopInfo::update(const shop_struct &shop_)
+{
+    shop = shop_;
+    stock_changed();
+}
+
+// The search generation starts at 1, so 0 is never current.
+void ShopInfo::stock_changed()
+{
+    search_text.clear();
+    search_text_generation = 0;
+}
+
 string ShopInfo::shop_item_name(const item_def &it) const
 {
     return make_stringf("%s%s (%d gold)",
@@ -628,14 +679,27 @@ vector<stash_search_result> ShopInfo::matches_search(
         }
     }
 
-    for (const item_def &item : shop.stock)
+    const unsigned int generation = StashTrack.get_search_generation();
+    if (search_text_generation != generation)
     {
+        search_text.clear();
+        for (const item_def &item : shop.stock)
+        {
+            search_text.emplace_back(
+                stash_annotate_item(STASH_LUA_SEARCH_ANNOTATE, &item),
+                shop_item_desc(item));
+        }
+        search_text_generation = generation;
+    }
+
+    for (size_t i = 0; i < shop.stock.size(); ++i)
+    {
+        const item_def &item = shop.stock[i];
         const string sname = shop_item_name(item);
-        const string ann   = stash_annotate_item(STASH_LUA_SEARCH_ANNOTATE,
-                                                 &item);
+        const string &ann  = search_text[i].first;
 
         string text = prefix + " " + ann + " " + sname + " {" + shoptitle + "}"
-                      + shop_item_desc(item);
+                      + search_text[i].second;
         if (search.matches(text))
         {
             stash_search_result res;
@@ -675,7 +739,9 @@ void ShopInfo::write(FILE *f, bool identify) const
 LevelStashes::LevelStashes()
     : m_place(level_id::current()),
       m_stashes(),
-      m_shops()
+      m_shops(),
+      m_search_index(),
+      m_search_index_stale(true)
 {
 }
 
@@ -772,12 +838,14 @@ void LevelStashes::move_stash(const coord_def& from, const coord_def& to)
     s->pos = to;
     m_stashes[s->pos] = *s;
     m_stashes.erase(old_pos);
+    m_search_index_stale = true;
 }
 
 // Removes a Stash from the level.
 void LevelStashes::kill_stash(const Stash &s)
 {
     m_stashes.erase(s.pos);
+    m_search_index_stale = true;
 }
 
 void LevelStashes::add_stash(coord_def p)
@@ -793,7 +861,10 @@ void LevelStashes::add_stash(coord_def p)
     {
         Stash new_stash(p);
         if (!new_stash.empty())
+        {
             m_stashes[new_stash.pos] = new_stash;
+            m_search_index_stale = true;
+        }
     }
 }
 
@@ -831,6 +902,24 @@ void LevelStashes::_waypoint_search(
     }
 }
 
+// Bring the search text of every stash up to date, and re-index it if any
+// of it changed.
+void LevelStashes::_update_search_index() const
+{
+    for (const auto &entry : m_stashes)
+        if (entry.second._update_search_text())
+            m_search_index_stale = true;
+    if (!m_search_index_stale)
+        return;
+
+    const string lplace = "{" + m_place.describe() + "}";
+    m_search_index.clear();
+    for (const auto &entry : m_stashes)
+        for (const string &text : entry.second.search_text)
+            m_search_index.add(lplace + " " + text);
+    m_search_index_stale = false;
+}
+
 void LevelStashes::get_matching_stashes(
         const base_pattern &search,
         vector<stash_search_result> &results) const
@@ -851,10 +940,17 @@ void LevelStashes::get_matching_stashes(
         return;
     }
 
+    // Only look closely at items whose text has what the search needs.
+    _update_search_index();
+    vector<bool> maybe;
+    m_search_index.candidates(search.required_literal(), maybe);
+
+    int first = 0;
     for (const auto &entry : m_stashes)
     {
         vector<stash_search_result> new_results =
-            entry.second.matches_search(lplace, search);
+            entry.second.matches_search(lplace, search, &maybe, first);
+        first += entry.second.items.size();
         for (auto &res : new_results)
         {
             res.pos.id = m_place;
@@ -930,6 +1026,7 @@ void LevelStashes::load(reader& inf)
     m_place.load(inf);
 
     m_stashes.clear();
+    m_search_index_stale = true;
     for (int i = 0; i < size; ++i)
     {
         Stash s;
@@ -1346,6 +1443,17 @@ void StashTracker::search_stashes(string search_term)
     update_corpses();
     update_identification();
 
+    // Item names and annotations depend on which types are identified.
+    bool ids_changed = false;
+    for (int i = 0; i < NUM_OBJECT_CLASSES && !ids_changed; ++i)
+        for (int j = 0; j < MAX_SUBTYPES && !ids_changed; ++j)
+            ids_changed = search_ids[i][j] != you.type_ids[i][j];
+    if (ids_changed)
+    {
+        search_ids = you.type_ids;
+        ++search_generation;
+    }
+
     if (search_term.empty())
     {
         stash_search_reader reader(buf, sizeof buf);
@@ -1798,7 +1906,7 @@ bool StashTracker::display_search_results(
                 me->add_tile(tile);
         }
         else if (res.shop)
-            me->add_tile(tile_def(tileidx_shop(&res.shop->shop)));
+            me->add_tile(tile_def(tileidx_shop(&res.shop->shop_data())));
         else if (feat_is_trap(res.feat))
             me->add_tile(tile_def(tileidx_trap(res.trap)));
         else if (feat_is_runed(res.feat))
@@ -47,8 +47,10 @@ public:
     // Returns true if this Stash is unvisited since the last update.
     bool unvisited() const;
 
+    // Only items[i] with (*maybe)[first + i] set are checked, if given.
     vector<stash_search_result> matches_search(
-        const string &prefix, const base_pattern &search) const;
+        const string &prefix, const base_pattern &search,
+        const vector<bool> *maybe = nullptr, int first = 0) const;
 
     void write(FILE *f, coord_def refpos, string place = "",
                bool identify = false) const;
@@ -64,6 +66,7 @@ private:
     void _update_corpses(int rot_time);
     void _update_identification();
     void add_item(item_def &item, bool add_to_front = false);
+    bool _update_search_text() const;
 
 private:
     bool visited;      // Is this correct to the best of our knowledge?
@@ -74,6 +77,13 @@ private:
 
     vector<item_def> items;
 
+    // What searches look through for each item: its annotations, name and
+    // artefact properties. Kept between searches, since the annotations
+    // come from Lua.
+    mutable vector<string> search_text;
+    mutable bool search_text_stale;
+    mutable unsigned int search_text_generation;
+
     static bool are_items_same(const item_def &, const item_def &,
                                bool exact = false);
 
@@ -97,13 +107,25 @@ public:
 
     bool is_at(coord_def other) const { return shop.pos == other; }
     bool is_visited() const { return !shop.stock.empty(); }
+    const shop_struct &shop_data() const { return shop; }
 
-    shop_struct shop;
+    // Replaces what we know of the shop, such as after a visit.
+    void update(const shop_struct &shop_);
 
 private:
+    // Only update() and load() change the stock, so that search_text is
+    // always dropped along with it.
+    shop_struct shop;
+    void stock_changed();
+
     string shop_item_name(const item_def &it) const;
     string shop_item_desc(const item_def &it) const;
 
+    // The annotations and description of each item in stock, for searches.
+    // Not the name, whose price can change.
+    mutable vector<pair<string, string>> search_text;
+    mutable unsigned int search_text_generation;
+
     friend class ST_ItemIterator;
 };
 
@@ -218,6 +240,7 @@ private:
     void _update_corpses(int rot_time);
     void _update_identification();
     void _waypoint_search(int n, vector<stash_search_result> &results) const;
+    void _update_search_index() const;
 
     typedef map<coord_def, Stash> stashes_t;
     typedef vector<ShopInfo> shops_t;
@@ -227,6 +250,11 @@ private:
     stashes_t m_stashes;
     shops_t m_shops;
 
+    // The search text of every item in m_stashes, in order, for narrowing
+    // down searches with some literal text in them.
+    mutable literal_index m_search_index;
+    mutable bool m_search_index_stale;
+
     friend class StashTracker;
     friend class ST_ItemIterator;
 };
@@ -234,7 +262,8 @@ private:
 class StashTracker
 {
 public:
-    StashTracker() : levels(), last_corpse_update(0)
+    StashTracker() : levels(), last_corpse_update(0), search_generation(1),
+                     search_ids(false)
     {
     }
 
@@ -274,6 +303,9 @@ public:
     void dump(const char *filename, bool identify = false) const;
 
     void remove_shop(const level_pos &pos);
+
+    // Changes whenever cached search text might need redoing.
+    unsigned int get_search_generation() const { return search_generation; }
 private:
     void get_matching_stashes(const base_pattern &search,
                               vector<stash_search_result> &results,
@@ -293,6 +325,10 @@ private:
 
     int last_corpse_update;
 
+    // Which item types were known when search_generation last changed.
+    unsigned int search_generation;
+    id_arr search_ids;
+
     friend class ST_ItemIterator;
 };
 
@@ -41,7 +41,7 @@ game_state::game_state()
       seen_hups(0), map_stat_gen(false), map_stat_dump_disconnect(false),
       obj_stat_gen(false), type(GAME_TYPE_NORMAL),
       last_type(GAME_TYPE_UNSPECIFIED), last_game_exit(game_exit::unknown),
-      marked_as_won(false), arena_suspended(false),
+      marked_as_won(false), arena_suspended(false), arena_batch(false),
       generating_level(false), dump_maps(false), test(false), script(false),
       build_db(false), use_des_cache(true), tests_selected(),
 #ifdef DGAMELAUNCH
@@ -79,6 +79,7 @@ struct game_state
     bool marked_as_won;
     bool arena_suspended;   // Set if the arena has been temporarily
                             // suspended.
+    bool arena_batch;       // Set while a batch arena runs undisplayed.
     bool generating_level;
 
     bool dump_maps;         // Dump map Lua to stderr on fresh parse.
@@ -9,6 +9,8 @@
 #include "store.h"
 
 #include <algorithm>
+#include <deque>
+#include <unordered_map>
 
 #include "dlua.h"
 #include "monster.h"
@@ -1203,6 +1205,100 @@ string &CrawlStoreValue::operator += (const string &_val)
     return get_string() += _val;
 }
 
+//////////////////////////////
+// Property keys
+
+namespace
+{
+    struct prop_key_table
+    {
+        // Indexed by atom; a deque so that names never move.
+        deque<string> names;
+        vector<unsigned char> bits;
+        unordered_map<string, unsigned> atoms;
+
+        // Names recently seen as a const char *, by address. A hit still
+        // compares the name, since the same address may hold another name
+        // by now if it wasn't a literal.
+        struct literal
+        {
+            const char *name;
+            unsigned atom;
+        };
+        static const size_t LITERALS = 1024;
+        literal literals[LITERALS];
+
+        prop_key_table() : literals() { }
+
+        unsigned intern(const string &name)
+        {
+            auto it = atoms.find(name);
+            if (it != atoms.end())
+                return it->second;
+            const unsigned atom = names.size();
+            names.push_back(name);
+            bits.push_back(name_bit(name));
+            atoms.emplace(name, atom);
+            return atom;
+        }
+
+        unsigned find(const string &name) const
+        {
+            auto it = atoms.find(name);
+            if (it == atoms.end())
+                return prop_key::NO_ATOM;
+            return it->second;
+        }
+
+        static unsigned name_bit(const string &name)
+        {
+            return hash<string>()(name) & 63;
+        }
+
+        unsigned intern(const char *name)
+        {
+            const uintptr_t addr = reinterpret_cast<uintptr_t>(name);
+            literal &lit = literals[(addr ^ addr >> 10) % LITERALS];
+            if (lit.name == name && names[lit.atom] == name)
+                return lit.atom;
+
+            lit.name = name;
+            lit.atom = intern(string(name));
+            return lit.atom;
+        }
+    };
+}
+
+// Not a plain static: tables with keys get built during static
+// initialisation.
+static prop_key_table &_prop_keys()
+{
+    static prop_key_table keys;
+    return keys;
+}
+
+prop_key::prop_key(const char *name) : _atom(_prop_keys().intern(name))
+{
+}
+
+// Doesn't intern: the name may have been made up at runtime.
+prop_key::prop_key(const string &name) : _atom(_prop_keys().find(name))
+{
+    if (!interned())
+        _name = name;
+}
+
+const string &prop_key::name() const
+{
+    return interned() ? _prop_keys().names[_atom] : _name;
+}
+
+unsigned prop_key::bit() const
+{
+    return interned() ? _prop_keys().bits[_atom]
+                      : prop_key_table::name_bit(_name);
+}
+
 //////////////////////////////
 // Read/write from/to savefile
 void CrawlHashTable::write(writer &th) const
@@ -1262,11 +1358,27 @@ static map<string, int> accesses;
 //////////////////
 // Misc functions
 
-bool CrawlHashTable::exists(const string &key) const
+bool CrawlHashTable::exists(const prop_key &key) const
 {
     ACCESS(key);
     ASSERT_VALIDITY();
-    return find(key) != end();
+    return may_contain(key) && table.find(key) != table.end();
+}
+
+CrawlHashTable::iterator CrawlHashTable::find(const prop_key &key)
+{
+    return may_contain(key) ? table.find(key) : table.end();
+}
+
+CrawlHashTable::const_iterator CrawlHashTable::find(const prop_key &key) const
+{
+    return may_contain(key) ? table.find(key) : table.end();
+}
+
+void CrawlHashTable::clear()
+{
+    table.clear();
+    key_mask = 0;
 }
 
 void CrawlHashTable::assert_validity() const
@@ -1333,15 +1445,16 @@ void CrawlHashTable::assert_validity() const
 ////////////////////////////////
 // Accessors to contained values
 
-CrawlStoreValue& CrawlHashTable::get_value(const string &key)
+CrawlStoreValue& CrawlHashTable::get_value(const prop_key &key)
 {
     ASSERT_VALIDITY();
     ACCESS(key);
+    key_mask |= uint64_t(1) << key.bit();
     // Inserts CrawlStoreValue() if the key was not found.
-    return map::operator[](key);
+    return table[key];
 }
 
-const CrawlStoreValue& CrawlHashTable::get_value(const string &key) const
+const CrawlStoreValue& CrawlHashTable::get_value(const prop_key &key) const
 {
     ASSERT_VALIDITY();
     ACCESS(key);
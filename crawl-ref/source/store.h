@@ -241,27 +241,82 @@ protected:
     friend class CrawlVector;
 };
 
-class CrawlHashTable : public map<string, CrawlStoreValue>
+// The name of a CrawlHashTable entry. Keys are usually built from string
+// literals, like the _KEY macros; those names are interned, so that each is
+// stored once, looked up by address without building a string, and compared
+// by a single integer compare. Interned names are never freed, so only a
+// const char * that is a literal (or otherwise lives for the whole process)
+// may be used: build keys for names made at runtime, like make_stringf()
+// ones, from a string. Such a key uses the interned name if there is one,
+// and otherwise carries its own copy.
+class prop_key
+{
+public:
+    prop_key(const char *name);
+    prop_key(const string &name);
+
+    const string &name() const;
+    const char *c_str() const { return name().c_str(); }
+    operator const string &() const { return name(); }
+
+    bool interned() const { return _atom != NO_ATOM; }
+
+    // A small integer, unique to the name within this process. Atoms depend
+    // on the order names were first seen, so never save them.
+    unsigned atom() const { return _atom; }
+
+    // A bit (0-63) from the name, the same whether or not it's interned.
+    unsigned bit() const;
+
+    bool operator == (const prop_key &other) const
+    {
+        if (interned() && other.interned())
+            return _atom == other._atom;
+        return name() == other.name();
+    }
+    bool operator != (const prop_key &other) const
+    {
+        return !(*this == other);
+    }
+    // By name, so that tables keep iterating (and saving) alphabetically.
+    bool operator < (const prop_key &other) const
+    {
+        if (interned() && _atom == other._atom)
+            return false;
+        return name() < other.name();
+    }
+
+    static const unsigned NO_ATOM = UINT_MAX;
+
+private:
+    unsigned _atom;
+    string _name; // only for names that aren't interned
+};
+
+class CrawlHashTable
 {
 public:
     friend class CrawlStoreValue;
 
+    typedef map<prop_key, CrawlStoreValue> table_type;
+    typedef table_type::value_type         value_type;
+    typedef table_type::iterator           iterator;
+    typedef table_type::const_iterator     const_iterator;
+
+    CrawlHashTable() : key_mask(0) { }
+
     void write(writer &) const;
     void read(reader &);
 
-    bool exists(const string &key) const;
+    bool exists(const prop_key &key) const;
 
     void assert_validity() const;
 
     // NOTE: If the const versions of get_value() or [] are given a
     // key which doesn't exist, they will assert.
-    const CrawlStoreValue& get_value(const string &key) const;
-    const CrawlStoreValue& get_value(const char *key) const
-    { return get_value(string(key)); }
-    const CrawlStoreValue& operator[] (const string &key) const
+    const CrawlStoreValue& get_value(const prop_key &key) const;
+    const CrawlStoreValue& operator[] (const prop_key &key) const
     { return get_value(key); }
-    const CrawlStoreValue& operator[] (const char *key) const
-    { return get_value(string(key)); }
 
     // NOTE: If get_value() or [] is given a key which doesn't exist
     // in the table, an unset/empty CrawlStoreValue will be created
@@ -270,12 +325,38 @@ public:
     // hash table has a type (rather than being heterogeneous)
     // then trying to assign a different type to the CrawlStoreValue
     // will assert.
-    CrawlStoreValue& get_value(const string &key);
-    CrawlStoreValue& get_value(const char *key)
-    { return get_value(string(key)); }
-    using map::operator[];
-    CrawlStoreValue& operator[] (const char *key)
-    { return get_value(string(key)); }
+    CrawlStoreValue& get_value(const prop_key &key);
+    CrawlStoreValue& operator[] (const prop_key &key)
+    { return get_value(key); }
+
+    iterator       begin()       { return table.begin(); }
+    iterator       end()         { return table.end(); }
+    const_iterator begin() const { return table.begin(); }
+    const_iterator end()   const { return table.end(); }
+
+    size_t size()  const { return table.size(); }
+    bool   empty() const { return table.empty(); }
+
+    iterator       find(const prop_key &key);
+    const_iterator find(const prop_key &key) const;
+    size_t count(const prop_key &key) const { return exists(key); }
+
+    size_t   erase(const prop_key &key) { return table.erase(key); }
+    iterator erase(const_iterator it)   { return table.erase(it); }
+    iterator erase(iterator it)         { return table.erase(it); }
+    void     clear();
+
+private:
+    // Whether a key may be in the table, from a bit per name that is set on
+    // insertion. Most lookups are for keys that aren't there, and this
+    // answers those without searching.
+    bool may_contain(const prop_key &key) const
+    {
+        return key_mask & (uint64_t(1) << key.bit());
+    }
+
+    table_type table;
+    uint64_t   key_mask;
 };
 
 // A CrawlVector is the vector version of CrawlHashTable, except that
@@ -115,7 +115,8 @@ extern set<pair<string, level_id> > auto_unique_annotations;
 extern abyss_state abyssal_state;
 
 reader::reader(const string &_read_filename, int minorVersion)
-    : _filename(_read_filename), _chunk(0), _pbuf(nullptr), _read_offset(0),
+    : _filename(_read_filename), _data(nullptr), _data_size(0),
+      _read_offset(0),
       _minorVersion(minorVersion), _safe_read(false)
 {
     _file       = fopen_u(_filename.c_str(), "rb");
@@ -123,17 +124,20 @@ reader::reader(const string &_read_filename, int minorVersion)
 }
 
 reader::reader(package *save, const string &chunkname, int minorVersion)
-    : _file(0), _chunk(0), opened_file(false), _pbuf(0), _read_offset(0),
+    : _file(0), opened_file(false), _data(0), _data_size(0), _read_offset(0),
      _minorVersion(minorVersion), _safe_read(false)
 {
     ASSERT(save);
-    _chunk = new chunk_reader(save, chunkname);
+    // Inflate the chunk in one go rather than byte by byte; unmarshalling
+    // then works straight from memory.
+    chunk_reader rd(save, chunkname);
+    rd.read_all(_chunk_data);
+    _data = _chunk_data.data();
+    _data_size = _chunk_data.size();
 }
 
 reader::~reader()
 {
-    if (_chunk)
-        delete _chunk;
     close();
 }
 
@@ -146,6 +150,15 @@ void reader::close()
 
 void reader::advance(size_t offset)
 {
+    // In memory, just step over the bytes; read() checks the bounds.
+    if (!_file)
+    {
+        read(nullptr, offset);
+        return;
+    }
+
+    // Read through a file rather than seeking, which would happily go past
+    // its end without a short read.
     char junk[128];
 
     while (offset)
@@ -159,7 +172,7 @@ void reader::advance(size_t offset)
 bool reader::valid() const
 {
     return (_file && !feof(_file)) ||
-           (_pbuf && _read_offset < _pbuf->size());
+           (_data && _read_offset < _data_size);
 }
 
 static NORETURN void _short_read(bool safe_read)
@@ -174,25 +187,18 @@ static NORETURN void _short_read(bool safe_read)
 // Reads input in network byte order, from a file or buffer.
 unsigned char reader::readByte()
 {
-    if (_file)
+    if (!_file)
     {
-        int b = fgetc(_file);
-        if (b == EOF)
+        if (_read_offset >= _data_size)
             _short_read(_safe_read);
-        return b;
-    }
-    else if (_chunk)
-    {
-        unsigned char buf;
-        if (_chunk->read(&buf, 1) != 1)
-            _short_read(_safe_read);
-        return buf;
+        return _data[_read_offset++];
     }
     else
     {
-        if (_read_offset >= _pbuf->size())
+        int b = fgetc(_file);
+        if (b == EOF)
             _short_read(_safe_read);
-        return (*_pbuf)[_read_offset++];
+        return b;
     }
 }
 
@@ -208,17 +214,12 @@ void reader::read(void *data, size_t size)
         else
             fseek(_file, (long)size, SEEK_CUR);
     }
-    else if (_chunk)
-    {
-        if (_chunk->read(data, size) != size)
-            _short_read(_safe_read);
-    }
     else
     {
-        if (_read_offset+size > _pbuf->size())
+        if (size > _data_size - _read_offset)
             _short_read(_safe_read);
         if (data && size)
-            memcpy(data, &(*_pbuf)[_read_offset], size);
+            memcpy(data, _data + _read_offset, size);
 
         _read_offset += size;
     }
@@ -237,10 +238,7 @@ void reader::setMinorVersion(int minorVersion)
 
 void reader::fail_if_not_eof(const string &name)
 {
-    char dummy;
-    if (_chunk ? _chunk->read(&dummy, 1) :
-        _file ? (fgetc(_file) != EOF) :
-        _read_offset >= _pbuf->size())
+    if (_file ? (fgetc(_file) != EOF) : _read_offset < _data_size)
     {
         fail("Incomplete read of \"%s\" - aborting.", name.c_str());
     }
@@ -256,17 +254,35 @@ void writer::check_ok(bool ok)
     }
 }
 
+writer::~writer()
+{
+    if (_chunk)
+    {
+        flush_chunk();
+        delete _chunk;
+    }
+}
+
+void writer::flush_chunk()
+{
+    if (!_chunk_buf.empty())
+        _chunk->write(&_chunk_buf[0], _chunk_buf.size());
+    _chunk_buf.clear();
+}
+
 void writer::writeByte(unsigned char ch)
 {
     if (failed)
         return;
 
-    if (_chunk)
-        _chunk->write(&ch, 1);
-    else if (_file)
-        check_ok(fputc(ch, _file) != EOF);
-    else
+    if (_pbuf)
+    {
         _pbuf->push_back(ch);
+        if (_chunk && _chunk_buf.size() >= CHUNK_BUFFER_SIZE)
+            flush_chunk();
+    }
+    else
+        check_ok(fputc(ch, _file) != EOF);
 }
 
 void writer::write(const void *data, size_t size)
@@ -274,15 +290,15 @@ void writer::write(const void *data, size_t size)
     if (failed)
         return;
 
-    if (_chunk)
-        _chunk->write(data, size);
-    else if (_file)
-        check_ok(fwrite(data, 1, size, _file) == size);
-    else
+    if (_pbuf)
     {
         const unsigned char* cdata = static_cast<const unsigned char*>(data);
         _pbuf->insert(_pbuf->end(), cdata, cdata+size);
+        if (_chunk && _chunk_buf.size() >= CHUNK_BUFFER_SIZE)
+            flush_chunk();
     }
+    else
+        check_ok(fwrite(data, 1, size, _file) == size);
 }
 
 long writer::tell()
@@ -375,65 +391,69 @@ uint8_t unmarshallUByte(reader &th)
     return th.readByte();
 }
 
+// The multi-byte values below are assembled locally and handed to the
+// writer/reader in one go, rather than a byte at a time.
+
 // Marshall 2 byte short in network order.
 void marshallShort(writer &th, short data)
 {
     // TODO: why does this use `short` and `char` when unmarshall uses int16_t??
     CHECK_INITIALIZED(data);
-    const char b2 = (char)(data & 0x00FF);
-    const char b1 = (char)((data & 0xFF00) >> 8);
-    th.writeByte(b1);
-    th.writeByte(b2);
+    const unsigned char b[2] =
+    {
+        (unsigned char)((data & 0xFF00) >> 8),
+        (unsigned char)(data & 0x00FF),
+    };
+    th.write(b, sizeof(b));
 }
 
 // Unmarshall 2 byte short in network order.
 int16_t unmarshallShort(reader &th)
 {
-    int16_t b1 = th.readByte();
-    int16_t b2 = th.readByte();
-    int16_t data = (b1 << 8) | (b2 & 0x00FF);
-    return data;
+    unsigned char b[2];
+    th.read(b, sizeof(b));
+    return (int16_t)((b[0] << 8) | b[1]);
 }
 
 // Marshall 4 byte int in network order.
 void marshallInt(writer &th, int32_t data)
 {
     CHECK_INITIALIZED(data);
-    char b4 = (char) (data & 0x000000FF);
-    char b3 = (char)((data & 0x0000FF00) >> 8);
-    char b2 = (char)((data & 0x00FF0000) >> 16);
-    char b1 = (char)((data & 0xFF000000) >> 24);
-
-    th.writeByte(b1);
-    th.writeByte(b2);
-    th.writeByte(b3);
-    th.writeByte(b4);
+    const uint32_t u = data;
+    const unsigned char b[4] =
+    {
+        (unsigned char)(u >> 24),
+        (unsigned char)(u >> 16),
+        (unsigned char)(u >> 8),
+        (unsigned char)u,
+    };
+    th.write(b, sizeof(b));
 }
 
 // Unmarshall 4 byte signed int in network order.
 int32_t unmarshallInt(reader &th)
 {
-    int32_t b1 = th.readByte();
-    int32_t b2 = th.readByte();
-    int32_t b3 = th.readByte();
-    int32_t b4 = th.readByte();
-
-    int32_t data = (b1 << 24) | ((b2 & 0x000000FF) << 16);
-    data |= ((b3 & 0x000000FF) << 8) | (b4 & 0x000000FF);
-    return data;
+    unsigned char b[4];
+    th.read(b, sizeof(b));
+    return (int32_t)((uint32_t)b[0] << 24 | (uint32_t)b[1] << 16
+                     | (uint32_t)b[2] << 8 | (uint32_t)b[3]);
 }
 
 void marshallUnsigned(writer& th, uint64_t v)
 {
+    // at most 10 bytes of 7 bits each
+    unsigned char buf[10];
+    size_t len = 0;
     do
     {
         unsigned char b = (unsigned char)(v & 0x7f);
         v >>= 7;
         if (v)
             b |= 0x80;
-        th.writeByte(b);
+        buf[len++] = b;
     }
     while (v);
+    th.write(buf, len);
 }
 
 uint64_t unmarshallUnsigned(reader& th)
@@ -814,6 +834,32 @@ static void _run_length_encode(writer &th, marshall m, const grid &g,
     m(th, last);
 }
 
+// A whole grid of shorts, in rectangle_iterator order, in one piece. The bytes
+// are the same as a marshallShort() per cell.
+template <typename grid>
+static void _marshall_short_grid(writer &th, const grid &g)
+{
+    vector<unsigned char> buf;
+    buf.reserve(GXM * GYM * 2);
+    for (rectangle_iterator ri(0); ri; ++ri)
+    {
+        const uint16_t v = g(*ri);
+        buf.push_back(v >> 8);
+        buf.push_back(v & 0xFF);
+    }
+    th.write(&buf[0], buf.size());
+}
+
+template <typename grid>
+static void _unmarshall_short_grid(reader &th, grid &g)
+{
+    vector<unsigned char> buf(GXM * GYM * 2);
+    th.read(&buf[0], buf.size());
+    const unsigned char *p = &buf[0];
+    for (rectangle_iterator ri(0); ri; ++ri, p += 2)
+        g(*ri) = (int16_t)(p[0] << 8 | p[1]);
+}
+
 template <typename unmarshall, typename grid>
 static void _run_length_decode(reader &th, unmarshall um, grid &g,
                                int width, int height)
@@ -2353,6 +2399,7 @@ void ShopInfo::load(reader& inf)
     else
 #endif
     unmarshall_shop(inf, shop);
+    stock_changed();
 }
 
 static void _tag_construct_lost_monsters(writer &th)
@@ -5080,6 +5127,8 @@ static void _tag_construct_level(writer &th)
 
     CANARY;
 
+    // The cells' fields are written straight into the writer's chunk
+    // buffer, which hands them on to the package in large pieces.
     for (int count_x = 0; count_x < GXM; count_x++)
         for (int count_y = 0; count_y < GYM; count_y++)
         {
@@ -5136,11 +5185,7 @@ static void _tag_construct_level(writer &th)
     // Save heightmap, if present.
     marshallByte(th, !!env.heightmap);
     if (env.heightmap)
-    {
-        grid_heightmap &heightmap(*env.heightmap);
-        for (rectangle_iterator ri(0); ri; ++ri)
-            marshallShort(th, heightmap(*ri));
-    }
+        _marshall_short_grid(th, *env.heightmap);
 
     CANARY;
 
@@ -5997,7 +6042,7 @@ void unmarshallMapCell(reader &th, map_cell& cell)
     {
         monster_info mi;
         _unmarshallMonsterInfo(th, mi);
-        cell.set_monster(mi);
+        cell.set_monster(move(mi));
     }
 
     // set this last so the other sets don't override this
@@ -6842,9 +6887,7 @@ static void _tag_read_level(reader &th)
     if (have_heightmap)
     {
         env.heightmap.reset(new grid_heightmap);
-        grid_heightmap &heightmap(*env.heightmap);
-        for (rectangle_iterator ri(0); ri; ++ri)
-            heightmap(*ri) = unmarshallShort(th);
+        _unmarshall_short_grid(th, *env.heightmap);
     }
 
     EAT_CANARY;
@@ -7582,6 +7625,12 @@ static void _tag_read_level_monsters(reader &th)
 #endif
         env.mgrid(m.pos()) = i;
     }
+
+    env.mons_used.clear();
+    for (int i = 0; i < MAX_MONSTERS; ++i)
+        if (env.mons[i].type != MONS_NO_MONSTER)
+            env.mons_used.add(i);
+
 #if TAG_MAJOR_VERSION == 34
     // This relies on TAG_YOU (including lost monsters) being unmarshalled
     // on game load before the initial level.
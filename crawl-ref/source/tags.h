@@ -61,15 +61,20 @@ public:
     writer(vector<unsigned char>* poutput)
         : _filename(), _file(0), _chunk(0), _ignore_errors(false),
           _pbuf(poutput), failed(false) { ASSERT(poutput); }
+    // Output to a save chunk is buffered, and handed over in large pieces.
     writer(package *save, const string &chunkname)
         : _filename(), _file(0), _chunk(0), _ignore_errors(false),
-          failed(false)
+          _pbuf(&_chunk_buf), failed(false)
     {
         ASSERT(save);
         _chunk = save->writer(chunkname);
+        _chunk_buf.reserve(CHUNK_BUFFER_SIZE);
     }
 
-    ~writer() { if (_chunk) delete _chunk; }
+    ~writer();
+
+    // A chunk writer's _pbuf points at its own _chunk_buf.
+    DISALLOW_COPY_AND_ASSIGN(writer);
 
     void writeByte(unsigned char byte);
     void write(const void *data, size_t size);
@@ -79,6 +84,9 @@ public:
 
 private:
     void check_ok(bool ok);
+    void flush_chunk();
+
+    static const size_t CHUNK_BUFFER_SIZE = 65536;
 
 private:
     string _filename;
@@ -87,6 +95,7 @@ private:
     bool _ignore_errors;
 
     vector<unsigned char>* _pbuf;
+    vector<unsigned char> _chunk_buf;
 
     bool failed;
 };
@@ -115,11 +124,17 @@ class reader
 public:
     reader(const string &filename, int minorVersion = TAG_MINOR_INVALID);
     reader(FILE* input, int minorVersion = TAG_MINOR_INVALID)
-        : _file(input), _chunk(0), opened_file(false), _pbuf(0),
+        : _file(input), opened_file(false), _data(0), _data_size(0),
           _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
     reader(const vector<unsigned char>& input,
            int minorVersion = TAG_MINOR_INVALID)
-        : _file(0), _chunk(0), opened_file(false), _pbuf(&input),
+        : _file(0), opened_file(false), _data(input.data()),
+          _data_size(input.size()), _read_offset(0),
+          _minorVersion(minorVersion), _safe_read(false) {}
+    // Reads straight from memory the caller keeps alive, such as a mapping.
+    reader(const unsigned char *data, size_t size,
+           int minorVersion = TAG_MINOR_INVALID)
+        : _file(0), opened_file(false), _data(data), _data_size(size),
           _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
     reader(package *save, const string &chunkname,
            int minorVersion = TAG_MINOR_INVALID);
@@ -141,10 +156,12 @@ public:
 private:
     string _filename;
     FILE* _file;
-    chunk_reader *_chunk;
     bool  opened_file;
-    const vector<unsigned char>* _pbuf;
-    unsigned int _read_offset;
+    const unsigned char *_data;
+    size_t _data_size;
+    // a whole inflated save chunk, read from memory
+    vector<unsigned char> _chunk_data;
+    size_t _read_offset;
     int _minorVersion;
     // always throw an exception rather than dying when reading past EOF
     bool _safe_read;
@@ -32,7 +32,7 @@ static inline void mutex_init(pthread_mutex_t &x)
     unix_pthread_create(th, PTHREAD_CREATE_JOINABLE, (start), (void*)(arg))
 #define thread_join(th) pthread_join(th, 0)
 #define thread_create_detached(th, start, arg)  \
-    unix_pthread_create(th, PTHREAD_CREATE_DETACHED, (start, (void*)(arg))
+    unix_pthread_create(th, PTHREAD_CREATE_DETACHED, (start), (void*)(arg))
 
 static inline int unix_pthread_create(pthread_t *th, int det,
                                       void *(*start)(void *), void *arg)
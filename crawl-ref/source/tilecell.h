@@ -25,7 +25,8 @@ struct packed_cell
     tileidx_t cloud;
     set<tileidx_t> icons;
 
-    // This is directly copied from env.map_knowledge by viewwindow()
+    // The terrain of env.map_knowledge, copied by viewwindow(); no monster
+    // or item (see map_cell::copy_terrain()).
     map_cell map_knowledge;
 
     bool is_highlighted_summoner;
@@ -72,6 +72,9 @@
 
 //#define DEBUG_WEBSOCKETS
 
+// Version of the packed map format; see web_cell_packer.
+#define PACKED_MAP_VERSION 1
+
 static unsigned int get_milliseconds()
 {
     // This is Unix-only, but so is Webtiles at the moment.
@@ -92,6 +95,8 @@ TilesFramework::TilesFramework() :
       m_next_view(coord_def(GXM, GYM)),
       m_next_view_tl(0, 0),
       m_next_view_br(-1, -1),
+      m_client_packed_map(false),
+      m_packed_map(false),
       m_need_full_map(true),
       m_text_menu("menu_txt"),
       m_print_fg(15)
@@ -100,6 +105,11 @@ TilesFramework::TilesFramework() :
     default_cell.tile.bg = TILE_FLAG_UNSEEN;
     m_current_view.fill(default_cell);
     m_next_view.fill(default_cell);
+
+    sent_knowledge default_knowledge;
+    default_knowledge.feat = DNGN_UNSEEN;
+    default_knowledge.mf = MF_UNSEEN;
+    m_sent_knowledge.init(default_knowledge);
 }
 
 TilesFramework::~TilesFramework()
@@ -441,6 +451,9 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
 
         m_dest_addrs.push_back(addr);
         m_controlled_from_web = primary->bool_;
+        // A new client has to ask for packed cells again (in reply to the
+        // version message) before it gets them.
+        m_client_packed_map = false;
     }
     else if (msgtype == "key")
     {
@@ -452,6 +465,7 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
     }
     else if (msgtype == "spectator_joined")
     {
+        m_client_packed_map = false;
         flush_messages();
         _send_everything();
         flush_messages();
@@ -590,6 +604,12 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
             c = CK_MOUSE_CMD;
         }
     }
+    else if (msgtype == "map_format")
+    {
+        JsonWrapper packed = json_find_member(obj.node, "packed");
+        packed.check(JSON_NUMBER);
+        m_client_packed_map = (int) packed->number_ == PACKED_MAP_VERSION;
+    }
     else if (msgtype == "set_option")
     {
         // this is an extremely brute force approach...
@@ -715,7 +735,9 @@ void TilesFramework::_send_version()
 #endif
 
     string title = CRAWL " " + string(Version::Long);
-    send_message("{\"msg\":\"version\",\"text\":\"%s\"}", title.c_str());
+    // Clients that can read packed map cells ask for them with map_format.
+    send_message("{\"msg\":\"version\",\"text\":\"%s\",\"packed_map\":%d}",
+                 title.c_str(), PACKED_MAP_VERSION);
 }
 
 void TilesFramework::send_milestone(const xlog_fields &xl)
@@ -1523,145 +1545,391 @@ void TilesFramework::write_tileidx(tileidx_t t)
         tiles.write_message("[%d,%d]", lo, hi);
 }
 
+void web_cell_delta::set_flag(web_tile_flag flag, bool value)
+{
+    set(WCF_TILE_FLAGS);
+    flags_set |= 1 << flag;
+    if (value)
+        flags |= 1 << flag;
+    else
+        flags &= ~(1 << flag);
+}
+
+static void _pack_varint(string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static void _pack_int(string &out, int value)
+{
+    // zigzag, so that small negative numbers stay short
+    const uint32_t u = value;
+    _pack_varint(out, value < 0 ? ~(u << 1) : u << 1);
+}
+
+static void _pack_tileidx(string &out, tileidx_t t)
+{
+    _pack_varint(out, t & 0xFFFFFFFF);
+    _pack_varint(out, t >> 32);
+}
+
+static string _base64(const string &data)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        const size_t n = min<size_t>(3, data.size() - i);
+        uint32_t bits = static_cast<uint8_t>(data[i]) << 16;
+        if (n > 1)
+            bits |= static_cast<uint8_t>(data[i + 1]) << 8;
+        if (n > 2)
+            bits |= static_cast<uint8_t>(data[i + 2]);
+        out += digits[bits >> 18 & 0x3F];
+        out += digits[bits >> 12 & 0x3F];
+        out += n > 1 ? digits[bits >> 6 & 0x3F] : '=';
+        out += n > 2 ? digits[bits & 0x3F] : '=';
+    }
+    return out;
+}
+
+web_cell_packer::web_cell_packer()
+    : m_run_start(0), m_run_length(0), m_last_end(0)
+{
+}
+
+void web_cell_packer::add(const coord_def &gc, const web_cell_delta &delta)
+{
+    if (!delta.fields)
+        return;
+
+    string body;
+    _pack_varint(body, delta.fields);
+    if (delta.has(WCF_FEAT))
+        _pack_int(body, delta.feat);
+    if (delta.has(WCF_MAP_FEATURE))
+        _pack_int(body, delta.map_feature);
+    if (delta.has(WCF_GLYPH))
+        _pack_varint(body, delta.glyph);
+    if (delta.has(WCF_COLOUR))
+        _pack_int(body, delta.colour);
+    if (delta.has(WCF_FLASH_COLOUR))
+        _pack_int(body, delta.flash_colour);
+    if (delta.has(WCF_FLASH_ALPHA))
+        _pack_int(body, delta.flash_alpha);
+    if (delta.has(WCF_FG))
+        _pack_tileidx(body, delta.fg);
+    if (delta.has(WCF_BASE))
+        _pack_int(body, delta.base);
+    if (delta.has(WCF_BG))
+        _pack_tileidx(body, delta.bg);
+    if (delta.has(WCF_CLOUD))
+        _pack_tileidx(body, delta.cloud);
+    if (delta.has(WCF_TILE_FLAGS))
+    {
+        _pack_varint(body, delta.flags_set);
+        _pack_varint(body, delta.flags);
+    }
+    if (delta.has(WCF_HALO))
+        _pack_int(body, delta.halo);
+    if (delta.has(WCF_ORB_GLOW))
+        _pack_int(body, delta.orb_glow);
+    if (delta.has(WCF_BLOOD_ROTATION))
+        _pack_int(body, delta.blood_rotation);
+    if (delta.has(WCF_TRAVEL_TRAIL))
+        _pack_int(body, delta.travel_trail);
+    if (delta.has(WCF_FLAVOUR))
+    {
+        _pack_int(body, delta.flv_floor);
+        _pack_int(body, delta.flv_special);
+    }
+
+    // Cells are added in row order, so a run can carry on into the next row.
+    const int index = gc.y * GXM + gc.x;
+    if (m_run_length && index == m_run_start + m_run_length && body == m_run)
+    {
+        ++m_run_length;
+        return;
+    }
+
+    flush_run();
+    m_run_start = index;
+    m_run_length = 1;
+    m_run = body;
+}
+
+void web_cell_packer::flush_run()
+{
+    if (!m_run_length)
+        return;
+
+    _pack_varint(m_data, m_run_start - m_last_end);
+    _pack_varint(m_data, m_run_length);
+    m_data += m_run;
+    m_last_end = m_run_start + m_run_length;
+    m_run_length = 0;
+}
+
+string web_cell_packer::finish(const coord_def &origin)
+{
+    flush_run();
+    if (m_data.empty())
+        return "";
+
+    string packed;
+    _pack_varint(packed, PACKED_MAP_VERSION);
+    _pack_varint(packed, GXM);
+    _pack_int(packed, origin.x);
+    _pack_int(packed, origin.y);
+    packed += m_data;
+
+    m_data.clear();
+    m_last_end = 0;
+    return _base64(packed);
+}
+
+static const char *_tile_flag_names[] =
+{
+    "bloody", "old_blood", "silenced", "highlighted_summoner", "sanctuary",
+    "blasphemy", "has_bfb_corpse", "liquefied", "quad_glow", "disjunct",
+    "mangrove_water", "awakened_forest",
+};
+COMPILE_CHECK(ARRAYSZ(_tile_flag_names) == NUM_WTF);
+
+static void _write_cell_json(const web_cell_delta &delta)
+{
+    if (delta.has(WCF_FEAT))
+        tiles.json_write_int("f", delta.feat);
+    if (delta.has(WCF_MAP_FEATURE))
+        tiles.json_write_int("mf", delta.map_feature);
+    if (delta.has(WCF_GLYPH))
+    {
+        char buf[5];
+        buf[wctoutf8(buf, delta.glyph)] = 0;
+        tiles.json_write_string("g", buf);
+    }
+    if (delta.has(WCF_COLOUR))
+        tiles.json_write_int("col", delta.colour);
+    if (delta.has(WCF_FLASH_COLOUR))
+        tiles.json_write_int("flc", delta.flash_colour);
+    if (delta.has(WCF_FLASH_ALPHA))
+        tiles.json_write_int("fla", delta.flash_alpha);
+}
+
+static void _write_tile_json(const web_cell_delta &delta)
+{
+    if (delta.has(WCF_FG))
+    {
+        tiles.json_write_name("fg");
+        tiles.write_tileidx(delta.fg);
+    }
+    if (delta.has(WCF_BASE))
+        tiles.json_write_int("base", delta.base);
+    if (delta.has(WCF_BG))
+    {
+        tiles.json_write_name("bg");
+        tiles.write_tileidx(delta.bg);
+    }
+    if (delta.has(WCF_CLOUD))
+    {
+        tiles.json_write_name("cloud");
+        tiles.write_tileidx(delta.cloud);
+    }
+    for (int i = 0; i < NUM_WTF; ++i)
+        if (delta.flags_set & 1 << i)
+            tiles.json_write_bool(_tile_flag_names[i], delta.flags & 1 << i);
+    if (delta.has(WCF_HALO))
+        tiles.json_write_int("halo", delta.halo);
+    if (delta.has(WCF_ORB_GLOW))
+        tiles.json_write_int("orb_glow", delta.orb_glow);
+    if (delta.has(WCF_BLOOD_ROTATION))
+        tiles.json_write_int("blood_rotation", delta.blood_rotation);
+    if (delta.has(WCF_TRAVEL_TRAIL))
+        tiles.json_write_int("travel_trail", delta.travel_trail);
+    if (delta.has(WCF_FLAVOUR))
+    {
+        tiles.json_open_object("flv");
+        tiles.json_write_int("f", delta.flv_floor);
+        if (delta.flv_special)
+            tiles.json_write_int("s", delta.flv_special);
+        tiles.json_close_object();
+    }
+}
+
+static void _diff_flag(web_cell_delta &delta, web_tile_flag flag,
+                       bool current, bool next)
+{
+    if (current != next)
+        delta.set_flag(flag, next);
+}
+
 void TilesFramework::_send_cell(const coord_def &gc,
                                 const screen_cell_t &current_sc, const screen_cell_t &next_sc,
-                                const map_cell &current_mc, const map_cell &next_mc,
+                                const sent_knowledge &current_mc, const map_cell &next_mc,
                                 map<uint32_t, coord_def>& new_monster_locs,
                                 bool force_full)
 {
-    if (current_mc.feat() != next_mc.feat())
-        json_write_int("f", next_mc.feat());
+    web_cell_delta delta;
 
-    if (next_mc.monsterinfo())
-        _send_monster(gc, next_mc.monsterinfo(), new_monster_locs, force_full);
-    else if (current_mc.monsterinfo())
-        json_write_null("mon");
+    if (current_mc.feat != next_mc.feat())
+    {
+        delta.set(WCF_FEAT);
+        delta.feat = next_mc.feat();
+    }
 
     map_feature mf = get_cell_map_feature(gc);
-    if (get_cell_map_feature(current_mc) != mf)
-        json_write_int("mf", mf);
+    if (current_mc.mf != mf)
+    {
+        delta.set(WCF_MAP_FEATURE);
+        delta.map_feature = mf;
+    }
 
     // Glyph and colour
     char32_t glyph = next_sc.glyph;
     if (current_sc.glyph != glyph)
     {
-        char buf[5];
-        buf[wctoutf8(buf, glyph)] = 0;
-        json_write_string("g", buf);
+        delta.set(WCF_GLYPH);
+        delta.glyph = glyph;
     }
     if ((current_sc.colour != next_sc.colour
          || current_sc.glyph == ' ') && glyph != ' ')
     {
         int col = next_sc.colour;
-        col = (_get_highlight(col) << 4) | macro_colour(col & 0xF);
-        json_write_int("col", col);
+        delta.set(WCF_COLOUR);
+        delta.colour = (_get_highlight(col) << 4) | macro_colour(col & 0xF);
     }
     if (current_sc.flash_colour != next_sc.flash_colour)
-        json_write_int("flc", next_sc.flash_colour);
+    {
+        delta.set(WCF_FLASH_COLOUR);
+        delta.flash_colour = next_sc.flash_colour;
+    }
     if (current_sc.flash_alpha != next_sc.flash_alpha)
-        json_write_int("fla", next_sc.flash_alpha);
-
-    json_open_object("t");
     {
-        // Tile data
-        const packed_cell &next_pc = next_sc.tile;
-        const packed_cell &current_pc = current_sc.tile;
-
-        const tileidx_t fg_idx = next_pc.fg & TILE_FLAG_MASK;
+        delta.set(WCF_FLASH_ALPHA);
+        delta.flash_alpha = next_sc.flash_alpha;
+    }
 
-        const bool in_water = _in_water(next_pc);
-        bool fg_changed = false;
+    // Tile data
+    const packed_cell &next_pc = next_sc.tile;
+    const packed_cell &current_pc = current_sc.tile;
 
-        if (next_pc.fg != current_pc.fg)
-        {
-            fg_changed = true;
+    const tileidx_t fg_idx = next_pc.fg & TILE_FLAG_MASK;
 
-            json_write_name("fg");
-            write_tileidx(next_pc.fg);
-            if (get_tile_texture(fg_idx) == TEX_DEFAULT)
-                json_write_int("base", (int) tileidx_known_base_item(fg_idx));
-        }
+    const bool in_water = _in_water(next_pc);
+    const bool fg_changed = next_pc.fg != current_pc.fg;
 
-        if (next_pc.bg != current_pc.bg)
-        {
-            json_write_name("bg");
-            write_tileidx(next_pc.bg);
-        }
-
-        if (next_pc.cloud != current_pc.cloud)
+    if (fg_changed)
+    {
+        delta.set(WCF_FG);
+        delta.fg = next_pc.fg;
+        if (get_tile_texture(fg_idx) == TEX_DEFAULT)
         {
-            json_write_name("cloud");
-            write_tileidx(next_pc.cloud);
-        }
-
-        if (next_pc.icons != current_pc.icons)
-            json_write_icons(next_pc.icons);
-
-        if (Options.show_blood) {
-            if (next_pc.is_bloody != current_pc.is_bloody)
-                json_write_bool("bloody", next_pc.is_bloody);
-
-            if (next_pc.old_blood != current_pc.old_blood)
-                json_write_bool("old_blood", next_pc.old_blood);
+            delta.set(WCF_BASE);
+            delta.base = tileidx_known_base_item(fg_idx);
         }
+    }
 
-        if (next_pc.is_silenced != current_pc.is_silenced)
-            json_write_bool("silenced", next_pc.is_silenced);
-
-        if (next_pc.halo != current_pc.halo)
-            json_write_int("halo", next_pc.halo);
-
-        if (next_pc.is_highlighted_summoner
-            != current_pc.is_highlighted_summoner)
-        {
-            json_write_bool("highlighted_summoner",
-                            next_pc.is_highlighted_summoner);
-        }
+    if (next_pc.bg != current_pc.bg)
+    {
+        delta.set(WCF_BG);
+        delta.bg = next_pc.bg;
+    }
 
-        if (next_pc.is_sanctuary != current_pc.is_sanctuary)
-            json_write_bool("sanctuary", next_pc.is_sanctuary);
-        if (next_pc.is_blasphemy != current_pc.is_blasphemy)
-            json_write_bool("blasphemy", next_pc.is_blasphemy);
+    if (next_pc.cloud != current_pc.cloud)
+    {
+        delta.set(WCF_CLOUD);
+        delta.cloud = next_pc.cloud;
+    }
 
-        if (next_pc.has_bfb_corpse != current_pc.has_bfb_corpse)
-            json_write_bool("has_bfb_corpse", next_pc.has_bfb_corpse);
+    if (Options.show_blood)
+    {
+        _diff_flag(delta, WTF_BLOODY, current_pc.is_bloody, next_pc.is_bloody);
+        _diff_flag(delta, WTF_OLD_BLOOD, current_pc.old_blood,
+                   next_pc.old_blood);
+    }
+    _diff_flag(delta, WTF_SILENCED, current_pc.is_silenced,
+               next_pc.is_silenced);
+    _diff_flag(delta, WTF_HIGHLIGHTED_SUMMONER,
+               current_pc.is_highlighted_summoner,
+               next_pc.is_highlighted_summoner);
+    _diff_flag(delta, WTF_SANCTUARY, current_pc.is_sanctuary,
+               next_pc.is_sanctuary);
+    _diff_flag(delta, WTF_BLASPHEMY, current_pc.is_blasphemy,
+               next_pc.is_blasphemy);
+    _diff_flag(delta, WTF_HAS_BFB_CORPSE, current_pc.has_bfb_corpse,
+               next_pc.has_bfb_corpse);
+    _diff_flag(delta, WTF_LIQUEFIED, current_pc.is_liquefied,
+               next_pc.is_liquefied);
+    _diff_flag(delta, WTF_QUAD_GLOW, current_pc.quad_glow, next_pc.quad_glow);
+    if (next_pc.disjunct != current_pc.disjunct)
+        delta.set_flag(WTF_DISJUNCT, next_pc.disjunct);
+    _diff_flag(delta, WTF_MANGROVE_WATER, current_pc.mangrove_water,
+               next_pc.mangrove_water);
+    _diff_flag(delta, WTF_AWAKENED_FOREST, current_pc.awakened_forest,
+               next_pc.awakened_forest);
 
-        if (next_pc.is_liquefied != current_pc.is_liquefied)
-            json_write_bool("liquefied", next_pc.is_liquefied);
+    if (next_pc.halo != current_pc.halo)
+    {
+        delta.set(WCF_HALO);
+        delta.halo = next_pc.halo;
+    }
 
-        if (next_pc.orb_glow != current_pc.orb_glow)
-            json_write_int("orb_glow", next_pc.orb_glow);
+    if (next_pc.orb_glow != current_pc.orb_glow)
+    {
+        delta.set(WCF_ORB_GLOW);
+        delta.orb_glow = next_pc.orb_glow;
+    }
 
-        if (next_pc.quad_glow != current_pc.quad_glow)
-            json_write_bool("quad_glow", next_pc.quad_glow);
+    if (next_pc.blood_rotation != current_pc.blood_rotation)
+    {
+        delta.set(WCF_BLOOD_ROTATION);
+        delta.blood_rotation = next_pc.blood_rotation;
+    }
 
-        if (next_pc.disjunct != current_pc.disjunct)
-            json_write_bool("disjunct", next_pc.disjunct);
+    if (next_pc.travel_trail != current_pc.travel_trail)
+    {
+        delta.set(WCF_TRAVEL_TRAIL);
+        delta.travel_trail = next_pc.travel_trail;
+    }
 
-        if (next_pc.mangrove_water != current_pc.mangrove_water)
-            json_write_bool("mangrove_water", next_pc.mangrove_water);
+    if (_needs_flavour(next_pc) &&
+        (next_pc.flv.floor != current_pc.flv.floor
+         || next_pc.flv.special != current_pc.flv.special
+         || !_needs_flavour(current_pc)
+         || force_full))
+    {
+        delta.set(WCF_FLAVOUR);
+        delta.flv_floor = next_pc.flv.floor;
+        delta.flv_special = next_pc.flv.special;
+    }
 
-        if (next_pc.awakened_forest != current_pc.awakened_forest)
-            json_write_bool("awakened_forest", next_pc.awakened_forest);
+    // With the packed format, everything above goes there, and the JSON
+    // for this cell only has what follows.
+    if (m_packed_map)
+        m_cell_packer.add(gc, delta);
+    else
+        _write_cell_json(delta);
 
-        if (next_pc.blood_rotation != current_pc.blood_rotation)
-            json_write_int("blood_rotation", next_pc.blood_rotation);
+    if (next_mc.monsterinfo())
+        _send_monster(gc, next_mc.monsterinfo(), new_monster_locs, force_full);
+    else if (!force_full && _sent_monster(gc))
+        json_write_null("mon");
 
-        if (next_pc.travel_trail != current_pc.travel_trail)
-            json_write_int("travel_trail", next_pc.travel_trail);
+    json_open_object("t");
+    {
+        if (!m_packed_map)
+            _write_tile_json(delta);
 
-        if (_needs_flavour(next_pc) &&
-            (next_pc.flv.floor != current_pc.flv.floor
-             || next_pc.flv.special != current_pc.flv.special
-             || !_needs_flavour(current_pc)
-             || force_full))
-        {
-            json_open_object("flv");
-            json_write_int("f", next_pc.flv.floor);
-            if (next_pc.flv.special)
-                json_write_int("s", next_pc.flv.special);
-            json_close_object();
-        }
+        if (next_pc.icons != current_pc.icons)
+            json_write_icons(next_pc.icons);
 
         if (fg_idx >= TILEP_MCACHE_START)
         {
@@ -1784,22 +2052,53 @@ void TilesFramework::_mcache_ref(bool inc)
 {
     for (int y = 0; y < GYM; y++)
         for (int x = 0; x < GXM; x++)
-        {
-            coord_def gc(x, y);
+            _mcache_ref(coord_def(x, y), inc);
+}
 
-            int fg_idx = m_current_view(gc).tile.fg & TILE_FLAG_MASK;
-            if (fg_idx >= TILEP_MCACHE_START)
-            {
-                mcache_entry *entry = mcache.get(fg_idx);
-                if (entry)
-                {
-                    if (inc)
-                        entry->inc_ref();
-                    else
-                        entry->dec_ref();
-                }
-            }
+void TilesFramework::_mcache_ref(const coord_def &gc, bool inc)
+{
+    int fg_idx = m_current_view(gc).tile.fg & TILE_FLAG_MASK;
+    if (fg_idx >= TILEP_MCACHE_START)
+    {
+        mcache_entry *entry = mcache.get(fg_idx);
+        if (entry)
+        {
+            if (inc)
+                entry->inc_ref();
+            else
+                entry->dec_ref();
         }
+    }
+}
+
+const monster_info *TilesFramework::_sent_monster(const coord_def &gc) const
+{
+    auto it = m_sent_monsters.find(gc);
+    return it == m_sent_monsters.end() ? nullptr : &it->second;
+}
+
+// Bring what the client is known to have for gc up to date, once its cell has
+// been sent. Only the cells sent need this: the rest haven't changed for the
+// client, so comparing against what it was last sent is still right.
+void TilesFramework::_update_sent_cell(const coord_def &gc)
+{
+    _mcache_ref(gc, false);
+    m_current_view(gc) = m_next_view(gc);
+    _mcache_ref(gc, true);
+
+    const map_cell &mc = env.map_knowledge(gc);
+    m_sent_knowledge(gc).feat = mc.feat();
+    m_sent_knowledge(gc).mf = get_cell_map_feature(gc);
+    if (const monster_info *mi = mc.monsterinfo())
+    {
+        auto it = m_sent_monsters.find(gc);
+        if (it == m_sent_monsters.end())
+            m_sent_monsters.emplace(gc, *mi);
+        else
+            it->second = *mi;
+    }
+    else
+        m_sent_monsters.erase(gc);
 }
 
 void TilesFramework::_send_map(bool force_full)
@@ -1814,6 +2113,7 @@ void TilesFramework::_send_map(bool force_full)
 
     force_full = force_full || m_need_full_map;
     m_need_full_map = false;
+    m_packed_map = m_client_packed_map && Options.tile_web_packed_map;
 
     json_open_object();
     json_write_string("msg", "map");
@@ -1845,7 +2145,9 @@ void TilesFramework::_send_map(bool force_full)
     default_cell.tile.bg = TILE_FLAG_UNSEEN;
     default_cell.glyph = ' ';
     default_cell.colour = 7;
-    map_cell default_map_cell;
+    sent_knowledge default_knowledge;
+    default_knowledge.feat = DNGN_UNSEEN;
+    default_knowledge.mf = get_cell_map_feature(map_cell());
 
     coord_def last_gc(0, 0);
     bool send_gc = true;
@@ -1854,61 +2156,68 @@ void TilesFramework::_send_map(bool force_full)
     if (flash_colour == BLACK)
         flash_colour = viewmap_flash_colour();
 
+    m_sent_cells.clear();
     json_open_array("cells");
-    for (int y = 0; y < GYM; y++)
-        for (int x = 0; x < GXM; x++)
-        {
-            coord_def gc(x, y);
-
-            if (!is_dirty(gc) && !force_full)
-                continue;
+    for (int i = force_full ? 0 : m_dirty_cells.next(0); i < GXM * GYM;
+         i = force_full ? i + 1 : m_dirty_cells.next(i + 1))
+    {
+        const int x = i % GXM, y = i / GXM;
+        coord_def gc(x, y);
 
-            if (cell_needs_redraw(gc))
-            {
-                screen_cell_t *cell = &m_next_view(gc);
+        if (cell_needs_redraw(gc))
+        {
+            screen_cell_t *cell = &m_next_view(gc);
 
-                if (you.flash_where && you.flash_where->is_affected(gc) <= 0)
-                    draw_cell(cell, gc, false, 0);
-                else
-                    draw_cell(cell, gc, false, flash_colour);
+            if (you.flash_where && you.flash_where->is_affected(gc) <= 0)
+                draw_cell(cell, gc, false, 0);
+            else
+                draw_cell(cell, gc, false, flash_colour);
 
-                pack_cell_overlays(gc, m_next_view);
-            }
+            pack_cell_overlays(gc, m_next_view);
+        }
 
-            mark_clean(gc);
+        mark_clean(gc);
+        m_sent_cells.push_back(gc);
 
-            if (m_origin.equals(-1, -1))
-                m_origin = gc;
+        if (m_origin.equals(-1, -1))
+            m_origin = gc;
 
-            json_open_object();
-            if (send_gc
-                || last_gc.x + 1 != gc.x
-                || last_gc.y != gc.y)
-            {
-                json_write_int("x", x - m_origin.x);
-                json_write_int("y", y - m_origin.y);
-                json_treat_as_empty();
-            }
+        json_open_object();
+        if (send_gc
+            || last_gc.x + 1 != gc.x
+            || last_gc.y != gc.y)
+        {
+            json_write_int("x", x - m_origin.x);
+            json_write_int("y", y - m_origin.y);
+            json_treat_as_empty();
+        }
 
-            const screen_cell_t& sc = force_full ? default_cell
-                : m_current_view(gc);
-            const map_cell& mc = force_full ? default_map_cell
-                : m_current_map_knowledge(gc);
-            _send_cell(gc,
-                       sc,
-                       m_next_view(gc),
-                       mc, env.map_knowledge(gc),
-                       new_monster_locs, force_full);
-
-            if (!json_is_empty())
-            {
-                send_gc = false;
-                last_gc = gc;
-            }
-            json_close_object(true);
+        const screen_cell_t& sc = force_full ? default_cell
+            : m_current_view(gc);
+        const sent_knowledge& mc = force_full ? default_knowledge
+            : m_sent_knowledge(gc);
+        _send_cell(gc,
+                   sc,
+                   m_next_view(gc),
+                   mc, env.map_knowledge(gc),
+                   new_monster_locs, force_full);
+
+        if (!json_is_empty())
+        {
+            send_gc = false;
+            last_gc = gc;
         }
+        json_close_object(true);
+    }
     json_close_array(true);
 
+    if (m_packed_map)
+    {
+        const string packed = m_cell_packer.finish(m_origin);
+        if (!packed.empty())
+            json_write_string("packed", packed);
+    }
+
     json_close_object(true);
 
     finish_message();
@@ -1916,14 +2225,15 @@ void TilesFramework::_send_map(bool force_full)
     if (force_full)
         _send_cursor(CURSOR_MAP);
 
-    if (m_mcache_ref_done)
-        _mcache_ref(false);
-
-    m_current_map_knowledge = env.map_knowledge;
-    m_current_view = m_next_view;
-
-    _mcache_ref(true);
+    // Done only now, as _send_monster() may look at a monster's old cell
+    // after that cell has been sent. If the mcache references were dropped
+    // while nobody was watching, take them again for the cells not being
+    // sent.
+    if (!m_mcache_ref_done)
+        _mcache_ref(true);
     m_mcache_ref_done = true;
+    for (const coord_def &gc : m_sent_cells)
+        _update_sent_cell(gc);
 
     m_monster_locs = new_monster_locs;
 }
@@ -1944,14 +2254,14 @@ void TilesFramework::_send_monster(const coord_def &gc, const monster_info* m,
     auto it = m_monster_locs.find(m->client_id);
     if (m->client_id == 0 || it == m_monster_locs.end())
     {
-        last = m_current_map_knowledge(gc).monsterinfo();
+        last = _sent_monster(gc);
 
         if (last && last->client_id != m->client_id)
             json_treat_as_nonempty(); // Force sending at least the id
     }
     else
     {
-        last = m_current_map_knowledge(it->second).monsterinfo();
+        last = _sent_monster(it->second);
 
         if (it->second != gc)
             json_treat_as_nonempty(); // As above
@@ -2023,7 +2333,10 @@ void TilesFramework::load_dungeon(const crawl_view_buffer &vbuf,
         {
             const coord_def cache_gc(x, y);
             screen_cell_t *cell = &m_next_view(cache_gc);
-            cell->tile.map_knowledge = map_bounds(cache_gc) ? env.map_knowledge(cache_gc) : map_cell();
+            if (map_bounds(cache_gc))
+                cell->tile.map_knowledge.copy_terrain(env.map_knowledge(cache_gc));
+            else
+                cell->tile.map_knowledge.clear();
         }
 
     m_next_view_tl = view2grid(coord_def(1, 1));
@@ -2373,28 +2686,28 @@ void TilesFramework::clear_to_end_of_line()
 void TilesFramework::mark_for_redraw(const coord_def& gc)
 {
     mark_dirty(gc);
-    m_cells_needing_redraw[gc.y * GXM + gc.x] = true;
+    m_cells_needing_redraw.add(gc.y * GXM + gc.x);
 }
 
 void TilesFramework::mark_dirty(const coord_def& gc)
 {
-    m_dirty_cells[gc.y * GXM + gc.x] = true;
+    m_dirty_cells.add(gc.y * GXM + gc.x);
 }
 
 void TilesFramework::mark_clean(const coord_def& gc)
 {
-    m_cells_needing_redraw[gc.y * GXM + gc.x] = false;
-    m_dirty_cells[gc.y * GXM + gc.x] = false;
+    m_cells_needing_redraw.remove(gc.y * GXM + gc.x);
+    m_dirty_cells.remove(gc.y * GXM + gc.x);
 }
 
 bool TilesFramework::is_dirty(const coord_def& gc)
 {
-    return m_dirty_cells[gc.y * GXM + gc.x];
+    return m_dirty_cells.contains(gc.y * GXM + gc.x);
 }
 
 bool TilesFramework::cell_needs_redraw(const coord_def& gc)
 {
-    return m_cells_needing_redraw[gc.y * GXM + gc.x];
+    return m_cells_needing_redraw.contains(gc.y * GXM + gc.x);
 }
 
 void TilesFramework::write_message_escaped(const string& s)
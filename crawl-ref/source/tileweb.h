@@ -92,6 +92,90 @@ struct player_info
     bool quiver_available;
 };
 
+// The simple fields of a map cell that _send_cell() sends when they change,
+// in the order the packed map format writes them.
+enum web_cell_field
+{
+    WCF_FEAT,
+    WCF_MAP_FEATURE,
+    WCF_GLYPH,
+    WCF_COLOUR,
+    WCF_FLASH_COLOUR,
+    WCF_FLASH_ALPHA,
+    WCF_FG,
+    WCF_BASE,
+    WCF_BG,
+    WCF_CLOUD,
+    WCF_TILE_FLAGS,
+    WCF_HALO,
+    WCF_ORB_GLOW,
+    WCF_BLOOD_ROTATION,
+    WCF_TRAVEL_TRAIL,
+    WCF_FLAVOUR,
+    NUM_WCF
+};
+
+// Boolean tile properties, sent together as WCF_TILE_FLAGS.
+enum web_tile_flag
+{
+    WTF_BLOODY,
+    WTF_OLD_BLOOD,
+    WTF_SILENCED,
+    WTF_HIGHLIGHTED_SUMMONER,
+    WTF_SANCTUARY,
+    WTF_BLASPHEMY,
+    WTF_HAS_BFB_CORPSE,
+    WTF_LIQUEFIED,
+    WTF_QUAD_GLOW,
+    WTF_DISJUNCT,
+    WTF_MANGROVE_WATER,
+    WTF_AWAKENED_FOREST,
+    NUM_WTF
+};
+
+// What changed in a cell, apart from its monster, doll, mcache entry, icons
+// and overlays, which are always sent as JSON.
+struct web_cell_delta
+{
+    web_cell_delta() : fields(0), flags_set(0), flags(0) { }
+
+    void set(web_cell_field field) { fields |= 1 << field; }
+    bool has(web_cell_field field) const { return fields & 1 << field; }
+    void set_flag(web_tile_flag flag, bool value);
+
+    uint32_t fields;
+    int feat, map_feature, colour, flash_colour, flash_alpha;
+    char32_t glyph;
+    tileidx_t fg, bg, cloud;
+    int base, halo, orb_glow, blood_rotation, travel_trail;
+    int flv_floor, flv_special;
+    uint32_t flags_set;     // which web_tile_flags changed...
+    uint32_t flags;         // ...and their new values.
+};
+
+// Packs cell deltas for "map" messages as runs of consecutive cells with the
+// same changes, using LEB128 varints throughout. unpack_cells() in
+// map_knowledge.js decodes this, so the two must be kept in step.
+class web_cell_packer
+{
+public:
+    web_cell_packer();
+
+    void add(const coord_def &gc, const web_cell_delta &delta);
+    // The cells added so far, base64 encoded, or "" if there were none.
+    // Clears the packer for the next message.
+    string finish(const coord_def &origin);
+
+private:
+    void flush_run();
+
+    string m_data;
+    string m_run;
+    int m_run_start;
+    int m_run_length;
+    int m_last_end;
+};
+
 class TilesFramework
 {
 public:
@@ -279,14 +363,34 @@ protected:
     coord_def m_next_view_tl;
     coord_def m_next_view_br;
 
-    bitset<GXM * GYM> m_dirty_cells;
-    bitset<GXM * GYM> m_cells_needing_redraw;
+    // Indexed by gc.y * GXM + gc.x, so _send_map() can visit the dirty cells
+    // in order without looking at every cell of a quiet map.
+    FixedIndexSet<GXM * GYM> m_dirty_cells;
+    FixedIndexSet<GXM * GYM> m_cells_needing_redraw;
     void mark_dirty(const coord_def& gc);
     void mark_clean(const coord_def& gc);
     bool is_dirty(const coord_def& gc);
     bool cell_needs_redraw(const coord_def& gc);
 
-    FixedArray<map_cell, GXM, GYM> m_current_map_knowledge;
+    // Whether the client can read packed map cells, and whether the map
+    // being sent is using them.
+    bool m_client_packed_map;
+    bool m_packed_map;
+    web_cell_packer m_cell_packer;
+
+    // What the client was last sent of each cell's map knowledge: only what
+    // _send_cell() diffs against, so keeping it up to date copies nothing
+    // from env.map_knowledge but the monsters in the cells just sent.
+    struct sent_knowledge
+    {
+        dungeon_feature_type feat;
+        map_feature mf;
+    };
+    FixedArray<sent_knowledge, GXM, GYM> m_sent_knowledge;
+    map<coord_def, monster_info> m_sent_monsters;
+    vector<coord_def> m_sent_cells;
+    const monster_info *_sent_monster(const coord_def &gc) const;
+    void _update_sent_cell(const coord_def &gc);
     map<uint32_t, coord_def> m_monster_locs;
     bool m_need_full_map;
 
@@ -316,12 +420,13 @@ protected:
 
     bool m_mcache_ref_done;
     void _mcache_ref(bool inc);
+    void _mcache_ref(const coord_def &gc, bool inc);
 
     void _send_cursor(cursor_type type);
     void _send_map(bool force_full = false);
     void _send_cell(const coord_def &gc,
                     const screen_cell_t &current_sc, const screen_cell_t &next_sc,
-                    const map_cell &current_mc, const map_cell &next_mc,
+                    const sent_knowledge &current_mc, const map_cell &next_mc,
                     map<uint32_t, coord_def>& new_monster_locs,
                     bool force_full);
     void _send_monster(const coord_def &gc, const monster_info* m,
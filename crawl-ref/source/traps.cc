@@ -167,8 +167,13 @@ bool trap_def::is_safe(actor* act) const
         return true;
 
     // Let players specify traps as safe via lua.
-    if (clua.callbooleanfn(false, "c_trap_is_safe", "s", trap_name(type).c_str()))
+    static lua_hook c_trap_is_safe("c_trap_is_safe");
+    if (c_trap_is_safe.active(clua)
+        && c_trap_is_safe.callbooleanfn(clua, false, "s",
+                                        trap_name(type).c_str()))
+    {
         return true;
+    }
 
     return false;
 }
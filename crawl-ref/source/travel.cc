@@ -624,14 +624,16 @@ static inline void _check_interesting_square(const coord_def pos,
 
 static void _userdef_run_stoprunning_hook()
 {
-    if (you.running)
-        clua.callfn("ch_stop_running", "s", _run_mode_name(you.running));
+    static lua_hook ch_stop_running("ch_stop_running");
+    if (you.running && ch_stop_running.active(clua))
+        ch_stop_running.callfn(clua, "s", _run_mode_name(you.running));
 }
 
 static void _userdef_run_startrunning_hook()
 {
-    if (you.running)
-        clua.callfn("ch_start_running", "s", _run_mode_name(you.running));
+    static lua_hook ch_start_running("ch_start_running");
+    if (you.running && ch_start_running.active(clua))
+        ch_start_running.callfn(clua, "s", _run_mode_name(you.running));
 }
 
 bool is_resting()
@@ -915,6 +917,7 @@ static void _find_travel_pos(const coord_def& youpos, int *move_x, int *move_y)
     travel_pathfind tp;
 
     tp.set_src_dst(youpos, you.running.pos);
+    tp.set_incremental();
 
     coord_def dest = tp.pathfind(RMODE_TRAVEL, false);
     if (dest.origin())
@@ -1225,6 +1228,97 @@ static void _fill_exclude_radius(const travel_exclude &exc)
 
 FixedVector<coord_def, GXM * GYM> travel_pathfind::circumference[2];
 
+static vector<pair<coord_def, coord_def>> _transporter_links()
+{
+    vector<pair<coord_def, coord_def>> links;
+    LevelInfo &li = travel_cache.get_level_info(level_id::current());
+    for (const transporter_info &ti : li.get_transporters())
+        links.emplace_back(ti.position, ti.destination);
+    return links;
+}
+
+// Travel floods outwards from its destination until it meets the player, so
+// the flood for the next step towards the same destination is the same flood,
+// stopped at another square, unless one of the squares it has looked at by
+// then has changed. Record what each flood read and wrote, in order, so that
+// later steps can check the squares read and replay the writes instead of
+// flooding again.
+struct travel_flood_record
+{
+    // One call to path_examine_point(), with the amount read and written
+    // before it.
+    struct examine
+    {
+        coord_def c;
+        int traveled_distance;
+        size_t reads;
+        size_t writes;
+    };
+
+    static const uint16_t UNREAD = 0xFFFF;
+
+    bool valid;
+    level_id place;
+    coord_def start;
+    bool ignore_danger;
+    bool slime_wall_check;
+    vector<pair<coord_def, coord_def>> transporters;
+
+    vector<examine> examines;
+    vector<coord_def> reads;
+    vector<pair<coord_def, int>> writes;
+
+    // What each square looked like when first read, or UNREAD.
+    FixedArray<uint16_t, GXM, GYM> signature;
+    // The examine that first reached each square, or -1.
+    FixedArray<int, GXM, GYM> reached;
+
+    travel_flood_record() : valid(false) { }
+
+    void reset(const coord_def &from, bool no_danger)
+    {
+        valid = true;
+        place = level_id::current();
+        start = from;
+        ignore_danger = no_danger;
+        slime_wall_check = g_Slime_Wall_Check;
+        transporters = _transporter_links();
+        examines.clear();
+        reads.clear();
+        writes.clear();
+        signature.init(UNREAD);
+        reached.init(-1);
+    }
+};
+
+// One each for floods with and without try_fallback.
+static travel_flood_record _travel_floods[2];
+
+// Everything about a square that a travel flood through it depends on.
+static uint16_t _travel_flood_signature(const coord_def &p,
+                                        bool ignore_danger, bool try_fallback)
+{
+    const dungeon_feature_type feat = env.map_knowledge(p).feat();
+    uint16_t sig = _feature_traverse_cost(feat);
+
+    if (is_travelsafe_square(p, false, ignore_danger, try_fallback))
+        sig |= 1 << 2;
+    else if (_is_reseedable(p, ignore_danger))
+    {
+        sig |= (is_exclude_root(p)   ? 1 :
+                is_excluded(p)       ? 2 :
+                !_is_safe_cloud(p)   ? 3
+                                     : 4) << 3;
+    }
+
+    if (!ignore_danger && is_excluded(p) && feat == DNGN_TRANSPORTER)
+        sig |= 1 << 6;
+    if (env.grid(p) == DNGN_TRANSPORTER_LANDING)
+        sig |= 1 << 7;
+
+    return sig;
+}
+
 // already defined in header
 // const int travel_pathfind::UNFOUND_DIST;
 // const int travel_pathfind::INFINITE_DIST;
@@ -1237,7 +1331,8 @@ travel_pathfind::travel_pathfind()
       unexplored_place(), greedy_place(), unexplored_dist(0), greedy_dist(0),
       refdist(nullptr), reseed_points(), features(nullptr), unreachables(),
       point_distance(travel_point_distance), next_iter_points(0),
-      traveled_distance(0), circ_index(0)
+      traveled_distance(0), circ_index(0), try_fallback(false),
+      incremental(false), flood_record(nullptr)
 {
 }
 
@@ -1381,6 +1476,19 @@ coord_def travel_pathfind::pathfind(run_mode_type rmode, bool fallback_explore)
                                  !actor_slime_wall_immune(&you));
     unwind_slime_wall_precomputer slime_neighbours(g_Slime_Wall_Check);
 
+    flood_record = nullptr;
+    if (incremental && runmode == RMODE_TRAVEL && !features)
+    {
+        travel_flood_record &rec = _travel_floods[try_fallback];
+        if (replay_flood(rec))
+            return next_travel_move;
+
+        memset(point_distance, 0, sizeof(travel_distance_grid_t));
+        next_travel_move.reset();
+        rec.reset(start, ignore_danger);
+        flood_record = &rec;
+    }
+
     // How many points we'll consider next iteration.
     next_iter_points = 0;
 
@@ -1578,6 +1686,9 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
     if (!in_bounds(dc) || unreachables.count(dc))
         return false;
 
+    if (flood_record)
+        record_flood_read(dc);
+
     if (floodout
         && (runmode == RMODE_EXPLORE || runmode == RMODE_EXPLORE_GREEDY))
     {
@@ -1703,7 +1814,11 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
     {
         return false;
     }
-    else if (dc == dest)
+
+    if (flood_record && flood_record->reached(dc) < 0)
+        flood_record->reached(dc) = flood_record->examines.size() - 1;
+
+    if (dc == dest)
     {
         // Hallelujah, we're home!
         if (_is_safe_move(c))
@@ -1736,6 +1851,8 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
                 is_excluded(dc)       ? PD_EXCLUDED_RADIUS :
                 !_is_safe_cloud(dc)   ? PD_CLOUD
                                       : PD_TRAP;
+            if (flood_record)
+                record_flood_write(dc);
         }
         return false;
     }
@@ -1758,6 +1875,9 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
                 point_distance[dc.x][dc.y] = PD_EXCLUDED_RADIUS;
         }
 
+        if (flood_record)
+            record_flood_write(dc);
+
         if (features && !ignore_hostile)
         {
             dungeon_feature_type feature = env.map_knowledge(dc).feat();
@@ -1796,6 +1916,63 @@ void travel_pathfind::good_square(const coord_def &c)
     }
 }
 
+void travel_pathfind::record_flood_read(const coord_def &p)
+{
+    uint16_t &sig = flood_record->signature(p);
+    if (sig == travel_flood_record::UNREAD)
+    {
+        sig = _travel_flood_signature(p, ignore_danger, try_fallback);
+        flood_record->reads.push_back(p);
+    }
+}
+
+void travel_pathfind::record_flood_write(const coord_def &p)
+{
+    flood_record->writes.emplace_back(p, point_distance[p.x][p.y]);
+}
+
+// Rebuilds the recorded flood up to the examine that first reached dest,
+// then runs that examine for real so that next_travel_move is chosen just as
+// a fresh flood would. Returns false if the record can't be used.
+bool travel_pathfind::replay_flood(const travel_flood_record &rec)
+{
+    if (!rec.valid
+        || rec.start != start
+        || rec.ignore_danger != ignore_danger
+        || rec.slime_wall_check != g_Slime_Wall_Check
+        || rec.place != level_id::current())
+    {
+        return false;
+    }
+
+    const int stop = rec.reached(dest);
+    if (stop < 0 || rec.transporters != _transporter_links())
+        return false;
+
+    const travel_flood_record::examine &ex = rec.examines[stop];
+    for (size_t i = 0; i < ex.reads; ++i)
+    {
+        const coord_def &p = rec.reads[i];
+        if (rec.signature(p)
+            != _travel_flood_signature(p, ignore_danger, try_fallback))
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < ex.writes; ++i)
+    {
+        const coord_def &p = rec.writes[i].first;
+        point_distance[p.x][p.y] = rec.writes[i].second;
+    }
+
+    traveled_distance = ex.traveled_distance;
+    next_iter_points = 0;
+    circ_index = 0;
+    ignore_hostile = false;
+    return path_examine_point(ex.c);
+}
+
 bool travel_pathfind::point_traverse_delay(const coord_def &c)
 {
     if (square_slows_movement(c))
@@ -1818,9 +1995,19 @@ bool travel_pathfind::path_examine_point(const coord_def &c)
     if (!in_bounds(c))
         return false;
 
+    if (flood_record)
+        record_flood_read(c);
+
     if (point_traverse_delay(c))
         return false;
 
+    if (flood_record)
+    {
+        flood_record->examines.push_back({c, traveled_distance,
+                                          flood_record->reads.size(),
+                                          flood_record->writes.size()});
+    }
+
     bool found_target = false;
 
     // For each point, we look at all surrounding points. Take them orthogonals
@@ -492,6 +492,8 @@ private:
     level_pos waypoints[TRAVEL_WAYPOINT_COUNT];
 };
 
+struct travel_flood_record;
+
 // Handles travel and explore floodfill pathfinding. Does not do interlevel
 // travel pathfinding directly (but is used internally by interlevel travel).
 // * All coordinates are grid coords.
@@ -534,6 +536,13 @@ public:
         ignore_danger = true;
     }
 
+    // For RMODE_TRAVEL, pick up the answer from the last flood towards the
+    // same destination when none of the squares it looked at have changed.
+    inline void set_incremental()
+    {
+        incremental = true;
+    }
+
     // Determine if the level is fully explored, when called after pathfind().
     int explore_status();
 
@@ -545,6 +554,9 @@ protected:
     bool square_slows_movement(const coord_def &c);
     void check_square_greed(const coord_def &c);
     void good_square(const coord_def &c);
+    bool replay_flood(const travel_flood_record &rec);
+    void record_flood_read(const coord_def &p);
+    void record_flood_write(const coord_def &p);
 
 protected:
     static const int UNFOUND_DIST  = -30000;
@@ -623,6 +635,10 @@ protected:
     // Attempt to path through temporary obstructions (like sealed doors)
     // due to the possibility they are no longer obstructing us
     bool try_fallback;
+
+    // Reuse earlier travel floods, and the one being recorded, if any.
+    bool incremental;
+    travel_flood_record *flood_record;
 };
 
 extern TravelCache travel_cache;
@@ -25,6 +25,15 @@
 #include "tag-version.h"
 #include "version.h"
 
+#ifdef UNIX
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 const coord_def MONSTER_PLACE(20, 20);
 
 const string CANG = "cang";
@@ -219,6 +228,18 @@ static void mons_check_flag(bool set, string& flag,
         mons_flag(flag, newflag);
 }
 
+static void _clear_level()
+{
+    dgn_reset_level();
+    for (rectangle_iterator ri(0); ri; ++ri)
+        env.grid(*ri) = DNGN_FLOOR;
+
+    los_changed();
+    you.hp = you.hp_max = PLAYER_MAXHP;
+    you.magic_points = you.max_magic_points = PLAYER_MAXMP;
+    you.species = SP_HUMAN;
+}
+
 static void initialize_crawl()
 {
     init_monsters();
@@ -234,14 +255,7 @@ static void initialize_crawl()
     init_element_colours();
     init_show_table(); // Initializes indices for get_feature_def.
 
-    dgn_reset_level();
-    for (rectangle_iterator ri(0); ri; ++ri)
-        env.grid(*ri) = DNGN_FLOOR;
-
-    los_changed();
-    you.hp = you.hp_max = PLAYER_MAXHP;
-    you.magic_points = you.max_magic_points = PLAYER_MAXMP;
-    you.species = SP_HUMAN;
+    _clear_level();
 }
 
 static string dice_def_string(dice_def dice)
@@ -751,40 +765,9 @@ static string canned_reports[][2] = {
                  " | Res: sanity | XP: ∞ | Int: god | Sz: !!!"))},
 };
 
-int main(int argc, char* argv[])
+static int _describe(string target)
 {
-    alarm(5);
-    crawl_state.test = true;
-    if (argc < 2)
-    {
-        printf("Usage: @? <monster name>\n");
-        return 0;
-    }
-
-    if (!strcmp(argv[1], "-version") || !strcmp(argv[1], "--version"))
-    {
-        printf("Monster stats Crawl version: %s\n", Version::Long);
-        return 0;
-    }
-    else if (!strcmp(argv[1], "-name") || !strcmp(argv[1], "--name"))
-    {
-        rng::seed();
-        printf("%s\n", make_name().c_str());
-        return 0;
-    }
-
-    initialize_crawl();
-
     mons_list mons;
-    string target = argv[1];
-
-    if (argc > 2)
-        for (int x = 2; x < argc; x++)
-        {
-            target.append(" ");
-            target.append(argv[x]);
-        }
-
     trim_string(target);
 
     const bool want_vault_spec = target.find("spec:") == 0;
@@ -1372,5 +1355,209 @@ int main(int argc, char* argv[])
 
         return 0;
     }
+    printf("No monster data for %s\n", target.c_str());
     return 1;
 }
+
+#ifdef UNIX
+// Answers a single query in a child process, so that each starts from the
+// level and random state a fresh run would, and one that runs for more than
+// five seconds can simply be killed. The answer always comes out as exactly
+// one line.
+static void _answer_query(const string &target)
+{
+    fflush(stdout);
+    int fds[2];
+    if (pipe(fds) < 0)
+    {
+        perror("pipe");
+        printf("No answer for %s\n", target.c_str());
+        return;
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        printf("No answer for %s\n", target.c_str());
+        return;
+    }
+    if (!pid)
+    {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+        signal(SIGALRM, SIG_DFL);
+        alarm(5);
+        _describe(target);
+        fflush(stdout);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    string answer;
+    char buf[1024];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) != 0)
+    {
+        if (n > 0)
+            answer.append(buf, n);
+        else if (errno != EINTR)
+            break;
+    }
+    close(fds[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+        printf("Timed out: %s\n", target.c_str());
+    else if (!WIFEXITED(status))
+        printf("Crashed on %s\n", target.c_str());
+    else if (answer.empty())
+        printf("No answer for %s\n", target.c_str());
+    else
+    {
+        answer = replace_all(answer, "\n", " ");
+        trim_string_right(answer);
+        printf("%s\n", answer.c_str());
+    }
+}
+
+// Answers one query per line from in until it is closed. Each answer is
+// exactly one line, so a caller can pipe a whole batch of names through a
+// single initialisation and match the replies up by line.
+static void _serve_queries(FILE *in)
+{
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), in))
+    {
+        string target = buf;
+        trim_string(target);
+        if (target.empty())
+            printf("Usage: <monster name>\n");
+        else
+            _answer_query(target);
+        fflush(stdout);
+    }
+}
+
+// Serves queries to each client that connects to the socket at path in
+// turn, replying over the connection itself.
+static int _serve_socket(const char *path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener < 0
+        || bind(listener, (const sockaddr *)&addr, sizeof(addr)) < 0
+        || listen(listener, SOMAXCONN) < 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    // A client hanging up mid-reply shouldn't take the server down.
+    signal(SIGPIPE, SIG_IGN);
+    const int out = dup(STDOUT_FILENO);
+    while (true)
+    {
+        const int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("accept");
+            return 1;
+        }
+
+        // Clients are served one at a time, so don't let an idle one hold
+        // up everyone else.
+        timeval timeout = { 5, 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        FILE *in = fdopen(conn, "r");
+        if (!in)
+        {
+            perror("fdopen");
+            close(conn);
+            continue;
+        }
+        dup2(conn, STDOUT_FILENO);
+        _serve_queries(in);
+        fflush(stdout);
+        clearerr(stdout);
+        dup2(out, STDOUT_FILENO);
+        fclose(in);
+    }
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    alarm(5);
+    crawl_state.test = true;
+    if (argc < 2)
+    {
+        printf("Usage: @? <monster name>\n");
+        return 0;
+    }
+
+    if (!strcmp(argv[1], "-version") || !strcmp(argv[1], "--version"))
+    {
+        printf("Monster stats Crawl version: %s\n", Version::Long);
+        return 0;
+    }
+    else if (!strcmp(argv[1], "-name") || !strcmp(argv[1], "--name"))
+    {
+        rng::seed();
+        printf("%s\n", make_name().c_str());
+        return 0;
+    }
+#ifdef UNIX
+    else if (!strcmp(argv[1], "-serve") || !strcmp(argv[1], "--serve"))
+    {
+        initialize_crawl();
+        alarm(0);
+        _serve_queries(stdin);
+        return 0;
+    }
+    else if (!strcmp(argv[1], "-socket") || !strcmp(argv[1], "--socket"))
+    {
+        if (argc < 3)
+        {
+            printf("Usage: %s -socket <path>\n", argv[0]);
+            return 1;
+        }
+        initialize_crawl();
+        alarm(0);
+        return _serve_socket(argv[2]);
+    }
+#endif
+
+    initialize_crawl();
+
+    string target = argv[1];
+
+    if (argc > 2)
+        for (int x = 2; x < argc; x++)
+        {
+            target.append(" ");
+            target.append(argv[x]);
+        }
+
+    return _describe(target);
+}
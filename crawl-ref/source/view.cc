@@ -1682,7 +1682,10 @@ void draw_cell(screen_cell_t *cell, const coord_def &gc,
         _draw_outside_los(cell, gc, ep); // in los bounds but not visible
 
 #ifdef USE_TILE
-    cell->tile.map_knowledge = map_bounds(gc) ? env.map_knowledge(gc) : map_cell();
+    if (map_bounds(gc))
+        cell->tile.map_knowledge.copy_terrain(env.map_knowledge(gc));
+    else
+        cell->tile.map_knowledge.clear();
     cell->flash_colour = BLACK;
     cell->flash_alpha = 0;
 #endif
@@ -80,6 +80,11 @@ function ($, comm, map_knowledge, view_data, monster_list, minimap,
         if (data.vgrdc)
             minimap.do_view_center_update(data.vgrdc.x, data.vgrdc.y);
 
+        // Packed cells have the simple fields, and come before any cells in
+        // JSON, which have the rest.
+        if (data.packed)
+            map_knowledge.merge(map_knowledge.unpack_cells(data.packed));
+
         if (data.cells)
             map_knowledge.merge(data.cells);
 
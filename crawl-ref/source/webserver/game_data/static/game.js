@@ -1,9 +1,9 @@
 define(["jquery", "exports", "comm", "client", "key_conversion", "./dungeon_renderer",
         "./display", "./minimap", "./enums", "./messages", "./options",
-        "./mouse_control", "./text", "./menu", "./action_panel",  "./player",
-        "./ui","./ui-layouts"],
+        "./mouse_control", "./map_knowledge", "./text", "./menu",
+        "./action_panel",  "./player", "./ui","./ui-layouts"],
 function ($, exports, comm, client, key_conversion, dungeon_renderer, display,
-        minimap, enums, messages, options, mouse_control) {
+        minimap, enums, messages, options, mouse_control, map_knowledge) {
     "use strict";
 
     var layout_parameters = null, ui_state, input_mode;
@@ -340,6 +340,8 @@ function ($, exports, comm, client, key_conversion, dungeon_renderer, display,
     {
         game_version = data;
         document.title = data.text;
+        if (data.packed_map == map_knowledge.PACKED_MAP_VERSION)
+            comm.send_message("map_format", { packed: data.packed_map });
     }
 
     function glyph_mode_font_init()
@@ -197,6 +197,117 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
 
     }
 
+    // Decoding of the packed cells in map messages. These are produced by
+    // web_cell_packer in tileweb.cc, which has the details of the format.
+    var PACKED_MAP_VERSION = 1;
+    var tile_flag_names = [
+        "bloody", "old_blood", "silenced", "highlighted_summoner",
+        "sanctuary", "blasphemy", "has_bfb_corpse", "liquefied", "quad_glow",
+        "disjunct", "mangrove_water", "awakened_forest",
+    ];
+    // The bit for each field, in the order they are packed.
+    var F = {
+        feat: 1 << 0, map_feature: 1 << 1, glyph: 1 << 2, colour: 1 << 3,
+        flash_colour: 1 << 4, flash_alpha: 1 << 5, fg: 1 << 6, base: 1 << 7,
+        bg: 1 << 8, cloud: 1 << 9, tile_flags: 1 << 10, halo: 1 << 11,
+        orb_glow: 1 << 12, blood_rotation: 1 << 13, travel_trail: 1 << 14,
+        flavour: 1 << 15,
+    };
+    var TILE_FIELDS = F.fg | F.base | F.bg | F.cloud | F.tile_flags | F.halo
+                      | F.orb_glow | F.blood_rotation | F.travel_trail
+                      | F.flavour;
+
+    function unpack_cells(packed)
+    {
+        var data = atob(packed);
+        var pos = 0;
+
+        function uint()
+        {
+            var result = 0, scale = 1, b;
+            do
+            {
+                b = data.charCodeAt(pos++);
+                result += (b & 0x7f) * scale;
+                scale *= 128;
+            } while (b & 0x80);
+            return result;
+        }
+
+        function sint()
+        {
+            var u = uint();
+            return u % 2 ? -(u + 1) / 2 : u / 2;
+        }
+
+        // Like TilesFramework::write_tileidx
+        function tileidx()
+        {
+            var lo = uint() | 0, hi = uint() | 0;
+            return hi ? [lo, hi] : lo;
+        }
+
+        function unpack_cell(x, y)
+        {
+            var cell = {x: x, y: y};
+            var fields = uint();
+            if (fields & F.feat) cell.f = sint();
+            if (fields & F.map_feature) cell.mf = sint();
+            if (fields & F.glyph) cell.g = String.fromCodePoint(uint());
+            if (fields & F.colour) cell.col = sint();
+            if (fields & F.flash_colour) cell.flc = sint();
+            if (fields & F.flash_alpha) cell.fla = sint();
+            if (!(fields & TILE_FIELDS))
+                return cell;
+
+            var t = cell.t = {};
+            if (fields & F.fg) t.fg = tileidx();
+            if (fields & F.base) t.base = sint();
+            if (fields & F.bg) t.bg = tileidx();
+            if (fields & F.cloud) t.cloud = tileidx();
+            if (fields & F.tile_flags)
+            {
+                var set = uint(), values = uint();
+                for (var i = 0; i < tile_flag_names.length; i++)
+                    if (set & (1 << i))
+                        t[tile_flag_names[i]] = !!(values & (1 << i));
+            }
+            if (fields & F.halo) t.halo = sint();
+            if (fields & F.orb_glow) t.orb_glow = sint();
+            if (fields & F.blood_rotation) t.blood_rotation = sint();
+            if (fields & F.travel_trail) t.travel_trail = sint();
+            if (fields & F.flavour)
+            {
+                t.flv = {f: sint()};
+                var special = sint();
+                if (special)
+                    t.flv.s = special;
+            }
+            return cell;
+        }
+
+        if (uint() != PACKED_MAP_VERSION)
+            throw new Error("Unknown packed map version");
+        var width = uint(), origin_x = sint(), origin_y = sint();
+
+        var cells = [];
+        var index = 0;
+        while (pos < data.length)
+        {
+            index += uint();
+            var run = uint();
+            var body = pos;
+            // Each cell in a run gets its own objects, since merge keeps them.
+            for (var i = 0; i < run; i++, index++)
+            {
+                pos = body;
+                cells.push(unpack_cell(index % width - origin_x,
+                                       Math.floor(index / width) - origin_y));
+            }
+        }
+        return cells;
+    }
+
     function merge_diff(vals)
     {
         $.each(vals, function (i, val)
@@ -210,6 +321,8 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
     return {
         get: get,
         merge: merge_diff,
+        unpack_cells: unpack_cells,
+        PACKED_MAP_VERSION: PACKED_MAP_VERSION,
         clear: clear,
         touch: touch,
         visible: visible,
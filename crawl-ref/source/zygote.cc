@@ -0,0 +1,449 @@
+/**
+ * @file
+ * @brief Pre-initialised fork server for launching games.
+ *
+ * A server started with -zygote loads the Lua interpreters, databases and
+ * maps once, then forks a game for every launcher that connects to its
+ * socket. Games share the loaded data copy-on-write and skip straight to
+ * reading the player's options. A launcher is crawl started with
+ * -zygote-connect in front of its usual options: it sends its command line,
+ * environment and working directory, passes its standard streams along
+ * with them, and waits to be told the game's pid and, later, its status.
+**/
+
+#include "AppHdr.h"
+
+#include "zygote.h"
+
+#ifdef UNIX
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "end.h"
+#include "initfile.h"
+#include "libutil.h"
+#include "mapdef.h" // depth_ranges, to reset SysEnv
+#include "startup.h"
+#include "state.h"
+
+extern char **environ;
+
+// Requests bigger than this are assumed to be garbage.
+static const uint32_t MAX_REQUEST_SIZE = 1 << 20;
+
+struct zygote_request
+{
+    int fds[3];
+    string cwd;
+    vector<string> args;
+    vector<string> env;
+};
+
+static bool _write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = static_cast<const char *>(buf);
+    while (len)
+    {
+        const ssize_t done = write(fd, p, len);
+        if (done < 0 && errno == EINTR)
+            continue;
+        if (done <= 0)
+            return false;
+        p += done;
+        len -= done;
+    }
+    return true;
+}
+
+static bool _read_all(int fd, void *buf, size_t len)
+{
+    char *p = static_cast<char *>(buf);
+    while (len)
+    {
+        const ssize_t done = read(fd, p, len);
+        if (done < 0 && errno == EINTR)
+            continue;
+        if (done <= 0)
+            return false;
+        p += done;
+        len -= done;
+    }
+    return true;
+}
+
+static sockaddr_un _socket_address(const string &path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        end(1, false, "Zygote socket path too long: %s", path.c_str());
+    strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+static int _listen_on(const string &path)
+{
+    const sockaddr_un addr = _socket_address(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        end(1, true, "Can't create zygote socket");
+
+    // Clear out the socket left behind by an earlier server.
+    unlink(path.c_str());
+    if (bind(fd, (const sockaddr *)&addr, sizeof(addr)) < 0
+        || listen(fd, SOMAXCONN) < 0)
+    {
+        end(1, true, "Can't listen on %s", path.c_str());
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+// Closes every descriptor passed in msg, for requests we turn down.
+static void _close_passed_fds(msghdr &msg)
+{
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        const size_t nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < nfds; ++i)
+        {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+            close(fd);
+        }
+    }
+}
+
+// Reads one launcher's request from conn. The standard streams come as
+// ancillary data with the length of the rest: NUL-terminated strings for
+// the working directory, the argument count, the arguments and then the
+// environment.
+static bool _read_request(int conn, zygote_request &req)
+{
+    uint32_t len = 0;
+    iovec iov = { &len, sizeof(len) };
+    union
+    {
+        cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(req.fds))];
+    } control;
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t got;
+    do
+    {
+        got = recvmsg(conn, &msg, 0);
+    }
+    while (got < 0 && errno == EINTR);
+    if (got < 0)
+        return false;
+
+    // Anything other than exactly the standard streams (including a
+    // truncated set) is refused, but whatever did arrive must be closed
+    // or it stays open in the zygote for good.
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || (msg.msg_flags & MSG_CTRUNC)
+        || cmsg->cmsg_level != SOL_SOCKET
+        || cmsg->cmsg_type != SCM_RIGHTS
+        || cmsg->cmsg_len != CMSG_LEN(sizeof(req.fds))
+        || CMSG_NXTHDR(&msg, cmsg))
+    {
+        _close_passed_fds(msg);
+        return false;
+    }
+    memcpy(req.fds, CMSG_DATA(cmsg), sizeof(req.fds));
+
+    bool ok = got == sizeof(len) && len <= MAX_REQUEST_SIZE;
+    string payload(ok ? len : 0, '\0');
+    ok = ok && _read_all(conn, &payload[0], len);
+
+    vector<string> fields;
+    for (size_t start = 0, nul; ok && start < payload.size(); start = nul + 1)
+    {
+        nul = payload.find('\0', start);
+        if (nul == string::npos)
+            break;
+        fields.push_back(payload.substr(start, nul - start));
+    }
+
+    const size_t argc = fields.size() >= 2 ? atoi(fields[1].c_str()) : 0;
+    if (!ok || !argc || fields.size() < argc + 2)
+    {
+        for (int fd : req.fds)
+            close(fd);
+        return false;
+    }
+
+    req.cwd = fields[0];
+    req.args.assign(fields.begin() + 2, fields.begin() + 2 + argc);
+    req.env.assign(fields.begin() + 2 + argc, fields.end());
+    return true;
+}
+
+static int _child_pipe[2];
+
+static void _note_child_exit(int)
+{
+    const int saved_errno = errno;
+    const char c = 0;
+    if (write(_child_pipe[1], &c, 1)) {};
+    errno = saved_errno;
+}
+
+// Tells the launcher of each game that has finished how it ended.
+static void _reap_games(map<pid_t, int> &games)
+{
+    char buf[64];
+    while (read(_child_pipe[0], buf, sizeof(buf)) > 0)
+        ;
+
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+        auto game = games.find(pid);
+        if (game == games.end())
+            continue;
+        const int32_t wire_status = status;
+        _write_all(game->second, &wire_status, sizeof(wire_status));
+        close(game->second);
+        games.erase(game);
+    }
+}
+
+static vector<string> _game_args;
+static vector<char *> _game_argv;
+
+// Turns the freshly forked child into the launcher's game.
+static void _become_game(zygote_request &req)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        dup2(req.fds[i], i);
+        if (req.fds[i] > 2)
+            close(req.fds[i]);
+    }
+    close(_child_pipe[0]);
+    close(_child_pipe[1]);
+
+    // Leave the zygote's process group, so that signals meant for the
+    // server don't take its games down with it.
+    setsid();
+
+    if (chdir(req.cwd.c_str()) < 0)
+        fprintf(stderr, "Can't change to %s\n", req.cwd.c_str());
+
+    vector<string> old_vars;
+    for (char **var = environ; *var; ++var)
+        old_vars.emplace_back(*var, strcspn(*var, "="));
+    for (const string &name : old_vars)
+        unsetenv(name.c_str());
+    for (const string &var : req.env)
+    {
+        const size_t eq = var.find('=');
+        if (eq != string::npos)
+            setenv(var.substr(0, eq).c_str(), var.c_str() + eq + 1, 1);
+    }
+
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    init_signals();
+
+    // Forget the zygote's own command line and environment before the
+    // game's are read, so that nothing it didn't ask for (-rc, -dir, -name,
+    // -rcdir, ...) carries over.
+    crawl_state.command_line_arguments.clear();
+    SysEnv = system_environment();
+    get_system_environment();
+
+    _game_args = req.args;
+    for (string &arg : _game_args)
+        _game_argv.push_back(&arg[0]);
+    _game_argv.push_back(nullptr);
+}
+
+void zygote_serve(const string &path, int &argc, char **&argv)
+{
+    startup_preload();
+
+    const int listener = _listen_on(path);
+
+    if (pipe(_child_pipe) < 0)
+        end(1, true, "Can't create zygote pipe");
+    for (int fd : _child_pipe)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    signal(SIGCHLD, _note_child_exit);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+
+    fprintf(stderr, "Zygote ready on %s\n", path.c_str());
+
+    // Launchers still waiting for their game to finish, by the game's pid.
+    map<pid_t, int> games;
+    while (true)
+    {
+        pollfd fds[2] = { { listener, POLLIN, 0 },
+                          { _child_pipe[0], POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            end(1, true, "Zygote poll failed");
+        }
+
+        _reap_games(games);
+
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        const int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0)
+            continue;
+        fcntl(conn, F_SETFD, FD_CLOEXEC);
+
+        // Don't let a stuck launcher hold up everyone else.
+        timeval timeout = { 5, 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        zygote_request req;
+        if (!_read_request(conn, req))
+        {
+            close(conn);
+            continue;
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(listener);
+            close(conn);
+            for (const auto &game : games)
+                close(game.second);
+            _become_game(req);
+            argc = _game_args.size();
+            argv = _game_argv.data();
+            return;
+        }
+
+        for (int fd : req.fds)
+            close(fd);
+
+        const int32_t wire_pid = pid;
+        if (pid < 0 || !_write_all(conn, &wire_pid, sizeof(wire_pid)))
+        {
+            close(conn);
+            continue;
+        }
+        games[pid] = conn;
+    }
+}
+
+static volatile pid_t _game_pid = 0;
+
+static void _forward_signal(int sig)
+{
+    if (_game_pid > 0)
+        kill(_game_pid, sig);
+}
+
+void zygote_connect(const string &path, int argc, char **argv)
+{
+    const sockaddr_un addr = _socket_address(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (const sockaddr *)&addr, sizeof(addr)) < 0)
+        end(1, true, "Can't connect to zygote at %s", path.c_str());
+
+    vector<string> args;
+    for (int i = 0; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "-zygote-connect") || !strcmp(arg, "--zygote-connect"))
+            ++i;
+        else
+            args.emplace_back(arg);
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd)))
+        end(1, true, "Can't find the working directory");
+
+    string payload;
+    payload.append(cwd).push_back('\0');
+    payload.append(to_string(args.size())).push_back('\0');
+    for (const string &arg : args)
+        payload.append(arg).push_back('\0');
+    for (char **var = environ; *var; ++var)
+        payload.append(*var).push_back('\0');
+
+    uint32_t len = payload.size();
+    iovec iov = { &len, sizeof(len) };
+    const int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    union
+    {
+        cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    int32_t pid = 0;
+    if (sendmsg(fd, &msg, 0) != sizeof(len)
+        || !_write_all(fd, payload.data(), payload.size())
+        || !_read_all(fd, &pid, sizeof(pid)))
+    {
+        end(1, true, "Zygote at %s didn't start a game", path.c_str());
+    }
+
+    // The webserver and dgamelaunch signal the process they started; pass
+    // that on to the game.
+    _game_pid = pid;
+    const int forwarded[] = { SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGWINCH };
+    for (int sig : forwarded)
+        signal(sig, _forward_signal);
+
+    int32_t status = 0;
+    if (!_read_all(fd, &status, sizeof(status)))
+        _exit(1);
+
+    if (WIFSIGNALED(status))
+    {
+        signal(WTERMSIG(status), SIG_DFL);
+        raise(WTERMSIG(status));
+    }
+    _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+}
+
+#endif
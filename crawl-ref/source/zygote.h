@@ -0,0 +1,17 @@
+/**
+ * @file
+ * @brief Pre-initialised fork server for launching games.
+**/
+
+#pragma once
+
+#ifdef UNIX
+// Does the startup work that doesn't depend on the player once, then forks a
+// game for each launcher that connects to the socket at path. Returns only in
+// a forked game, with argc and argv replaced by the launcher's command line.
+void zygote_serve(const string &path, int &argc, char **&argv);
+
+// Hands this process's command line, environment and standard streams over
+// to the zygote at path, then exits with the status of the game it forks.
+NORETURN void zygote_connect(const string &path, int argc, char **argv);
+#endif